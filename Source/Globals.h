@@ -32,6 +32,33 @@ void fitButtonInRightBounds(Bounds& bounds, ButtonType& button)
 	button.setBounds(bounds.removeFromRight(button.getWidth()));
 }
 
+//runs job(0) to job(numJobs - 1) on the pool and waits until all of them are done
+//called from a pool job (e.g. a job that builds a Tree) the jobs run one after another on the calling thread instead,
+//waiting there for jobs queued behind it could deadlock the pool
+inline void runParallel(juce::ThreadPool& threadPool, int numJobs, std::function<void(int jobIndex)> job)
+{
+	if (juce::ThreadPoolJob::getCurrentThreadPoolJob() != nullptr)
+	{
+		for (int i = 0; i < numJobs; i++)
+			job(i);
+		return;
+	}
+
+	std::atomic<int> remainingJobs{ numJobs };
+	juce::WaitableEvent allFinished;
+	for (int i = 0; i < numJobs; i++)
+	{
+		threadPool.addJob([&, i]
+		{
+			job(i);
+			if (--remainingJobs == 0)
+				allFinished.signal();
+		});
+	}
+	if (numJobs > 0)
+		allFinished.wait();
+}
+
 inline juce::String getValueTreeID(juce::ValueTree& valueTree) { return valueTree.getType().toString(); }
 inline juce::XmlElement::TextFormat getXmlNoWrapFormat()
 {
@@ -0,0 +1,122 @@
+#include "JsonArchive.h"
+
+namespace json
+{
+ArchiveReader::ArchiveReader(const juce::File& archiveFile)
+{
+    if (!archiveFile.existsAsFile())
+        return;
+
+    if (archiveFile.hasFileExtension(".gz"))
+    {
+        m_gzipFile = archiveFile;
+        m_entryNames.push_back(archiveFile.getFileNameWithoutExtension());
+        return;
+    }
+
+    m_zipFile = std::make_unique<juce::ZipFile>(archiveFile);
+    for (int i = 0; i < m_zipFile->getNumEntries(); i++)
+    {
+        auto& name = m_zipFile->getEntry(i)->filename;
+        if (name.endsWithIgnoreCase(".json"))
+        {
+            m_entryNames.push_back(name);
+            m_zipIndices.push_back(i);
+        }
+    }
+}
+
+juce::String ArchiveReader::readEntry(int entryIndex)
+{
+    if (entryIndex < 0 || entryIndex >= getNumEntries())
+        return juce::String();
+
+    std::unique_ptr<juce::InputStream> input;
+    size_t numTextBytes = 0;
+    if (m_zipFile != nullptr)
+    {
+        auto zipIndex = m_zipIndices[(size_t)entryIndex];
+        numTextBytes = (size_t)m_zipFile->getEntry(zipIndex)->uncompressedSize;
+        input.reset(m_zipFile->createStreamForEntry(zipIndex));
+    }
+    else
+    {
+        input = std::make_unique<juce::GZIPDecompressorInputStream>(new juce::FileInputStream(m_gzipFile), true, juce::GZIPDecompressorInputStream::gzipFormat);
+    }
+    if (input == nullptr)
+        return juce::String();
+
+    //the inflated bytes go straight into the string's own buffer, which grows if the entry's size isn't known up front
+    juce::String text;
+    size_t capacity = juce::jmax(numTextBytes, (size_t)64 * 1024);
+    text.preallocateBytes(capacity);
+    size_t numBytes = 0;
+    for (;;)
+    {
+        auto data = text.getCharPointer().getAddress();
+        if (numBytes == capacity)
+        {
+            //full, it's only grown if there's more to read
+            char nextByte;
+            if (input->read(&nextByte, 1) <= 0)
+                break;
+            capacity *= 2;
+            text.preallocateBytes(capacity);
+            data = text.getCharPointer().getAddress();
+            data[numBytes++] = nextByte;
+        }
+        auto numToRead = (int)juce::jmin(capacity - numBytes, (size_t)std::numeric_limits<int>::max());
+        auto numRead = input->read(data + numBytes, numToRead);
+        if (numRead <= 0)
+            break;
+        numBytes += (size_t)numRead;
+    }
+    auto data = text.getCharPointer().getAddress();
+    data[numBytes] = 0;
+
+    //a byte order mark isn't part of the json
+    if (numBytes >= 3 && (juce::uint8)data[0] == 0xef && (juce::uint8)data[1] == 0xbb && (juce::uint8)data[2] == 0xbf)
+        memmove(data, data + 3, numBytes - 2);
+    return text;
+}
+
+void ArchiveReader::forEachEntry(const EntryParser& parseEntry, juce::ThreadPool* threadPool)
+{
+    //from a pool job the read-ahead job could wait behind the caller (same as runParallel())
+    if (threadPool == nullptr || juce::ThreadPoolJob::getCurrentThreadPoolJob() != nullptr)
+    {
+        for (int i = 0; i < getNumEntries(); i++)
+        {
+            Stream stream(readEntry(i), true);
+            parseEntry(i, stream);
+        }
+        return;
+    }
+
+    //one entry is inflated ahead, only one thread reads the archive at a time
+    juce::String nextText;
+    juce::WaitableEvent nextIsRead;
+    auto readAhead = [&](int entryIndex)
+    {
+        threadPool->addJob([&, entryIndex]
+        {
+            nextText = readEntry(entryIndex);
+            nextIsRead.signal();
+        });
+    };
+
+    if (getNumEntries() > 0)
+        readAhead(0);
+    for (int i = 0; i < getNumEntries(); i++)
+    {
+        nextIsRead.wait();
+        auto text = std::move(nextText);
+        if (i + 1 < getNumEntries())
+            readAhead(i + 1);
+
+        Stream stream(text, true);
+        parseEntry(i, stream);
+    }
+}
+
+} //namespace json
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "JsonStream.h"
+
+namespace json
+{
+
+//reads the json files in a zip archive (e.g. Spotify's my_spotify_data.zip) or a .gz file without extracting them to disk
+//each entry is inflated in memory (Stream parses one text), with a thread pool the next entry is inflated while
+//the current one is parsed
+class ArchiveReader
+{
+public:
+	//==============================================================================
+	//files ending in .gz are read as one gzip entry, anything else as a zip archive
+	ArchiveReader(const juce::File& archiveFile);
+
+	bool isValid() const { return m_zipFile != nullptr || m_gzipFile.existsAsFile(); }
+
+	//only the entries whose name ends in .json (folders and other files of the archive are left out)
+	int getNumEntries() const { return (int)m_entryNames.size(); }
+	//path inside the archive, the file name without .gz for gzip files
+	const juce::String& getEntryName(int entryIndex) const { return m_entryNames[(size_t)entryIndex]; }
+
+	//inflates the entry, empty if it can't be read
+	juce::String readEntry(int entryIndex);
+
+	//the stream is read-only and only valid during the call, entries are parsed in order on the calling thread
+	typedef std::function<void(int entryIndex, Stream& stream)> EntryParser;
+	void forEachEntry(const EntryParser& parseEntry, juce::ThreadPool* threadPool = nullptr);
+
+private:
+	//==============================================================================
+	std::unique_ptr<juce::ZipFile> m_zipFile;
+	juce::File m_gzipFile;
+	std::vector<juce::String> m_entryNames;
+	//m_zipFile's index of each entry
+	std::vector<int> m_zipIndices;
+
+	//==============================================================================
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ArchiveReader)
+};
+
+} //namespace json
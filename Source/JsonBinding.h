@@ -0,0 +1,272 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "JsonStream.h"
+
+namespace json
+{
+
+//compile-time map of json paths to a struct's members, records are decoded in one forward pass over a Stream
+//
+//	static constexpr auto trackBinding = json::makeBinding<Track>(json::bind("track/name", &Track::songName),
+//	                                                              json::bind("track/artists/[0]/name", &Track::artistName));
+//	trackBinding.decodeArray(stream, tracks); //stream at '['
+//
+//paths are property keys separated by '/', "[n]" is an array's n-th element
+//members can be juce::String (the text as it's written, escape sequences aren't applied, same as Stream::getString()),
+//bool, integers and floating point types. missing values and values of another type leave the member as it is
+//keys are compared in the text, only bound values are read and everything else is skipped, so no Positions are made
+template<class StructType, class MemberType>
+struct FieldBinding
+{
+	const char* path;
+	MemberType StructType::* member;
+};
+
+template<class StructType, class MemberType>
+constexpr FieldBinding<StructType, MemberType> bind(const char* path, MemberType StructType::* member) { return { path, member }; }
+
+template<class StructType, class... Fields>
+class Binding
+{
+public:
+	static constexpr size_t numFields = sizeof...(Fields);
+	static_assert(numFields > 0 && numFields <= 64, "fields are kept in a 64-bit mask");
+
+	constexpr Binding(Fields... fields) : m_fields(fields...), m_paths{ fields.path... } {}
+
+	//stream at the record's '{' (or '['), ends after its closing char
+	//@return false if the stream isn't at a scope
+	bool decode(Stream& stream, StructType& output) const
+	{
+		if (!stream.isAtScopeStart())
+			return false;
+		decodeValue(stream, output, m_paths, 0);
+		return true;
+	}
+
+	//stream at '[', ends after ']'. every object element is decoded into a new struct, other elements are skipped
+	//@return number of decoded records
+	size_t decodeArray(Stream& stream, vArray<StructType>& output) const
+	{
+		if (!stream.isAtChar('['))
+			return 0;
+
+		size_t numDecoded = 0;
+		stream.readNextPosition(); //after '['
+		while (skipToValue(stream, ']'))
+		{
+			if (stream.isAtChar('{'))
+			{
+				output.add(StructType());
+				decodeValue(stream, output.getLast(), m_paths, 0);
+				numDecoded++;
+			}
+			else
+				skipValue(stream);
+		}
+		stream.readNextPosition(); //after ']'
+		return numDecoded;
+	}
+
+private:
+	//==============================================================================
+	//the rest of each field's path inside the current scope, nullptr for fields that aren't inside it
+	typedef std::array<const char*, numFields> PathCursors;
+
+	//@return bits of the fields whose path ends at the segment, childCursors get the rest of the paths that go through it
+	static juce::uint64 matchSegment(const PathCursors& cursors, const char* segment, size_t numBytes, PathCursors& childCursors, bool& hasChildren)
+	{
+		juce::uint64 leafFields = 0;
+		for (size_t i = 0; i < numFields; i++)
+		{
+			auto path = cursors[i];
+			childCursors[i] = nullptr;
+			if (path == nullptr || strncmp(path, segment, numBytes) != 0)
+				continue;
+
+			if (path[numBytes] == 0)
+				leafFields |= (juce::uint64)1 << i;
+			else if (path[numBytes] == '/')
+			{
+				childCursors[i] = path + numBytes + 1;
+				hasChildren = true;
+			}
+		}
+		return leafFields;
+	}
+
+	void decodeValue(Stream& stream, StructType& output, const PathCursors& cursors, juce::uint64 leafFields) const
+	{
+		switch (getTypeFromChar(stream.getCurrentChar()))
+		{
+			case Type::Object: decodeObject(stream, output, cursors); break;
+			case Type::Array:  decodeElements(stream, output, cursors); break;
+			case Type::String:
+			{
+				auto text = stream.getReader().getAddress() + 1;
+				stream.skipString(false);
+				if (leafFields != 0)
+					readFields(output, leafFields, Type::String, text, (size_t)(stream.getReader().getAddress() - text), std::index_sequence_for<Fields...>());
+				stream.readNextPosition();
+				break;
+			}
+			case Type::Number:
+			{
+				auto text = stream.getReader().getAddress();
+				stream.skipNumber(true);
+				if (leafFields != 0)
+					readFields(output, leafFields, Type::Number, text, (size_t)(stream.getReader().getAddress() - text), std::index_sequence_for<Fields...>());
+				break;
+			}
+			case Type::Bool:
+				if (leafFields != 0)
+					readFields(output, leafFields, Type::Bool, stream.getReader().getAddress(), 0, std::index_sequence_for<Fields...>());
+				stream.skipBool(true);
+				break;
+			case Type::Null: stream.skipNull(true); break;
+			default: jassertfalse; stream.readNextPosition(); break; //unexpected char
+		}
+	}
+
+	void decodeObject(Stream& stream, StructType& output, const PathCursors& cursors) const
+	{
+		stream.readNextPosition(); //after '{'
+		while (skipToValue(stream, '}'))
+		{
+			auto key = stream.getReader().getAddress() + 1;
+			stream.skipString(false);
+			PathCursors childCursors;
+			bool hasChildren = false;
+			auto leafFields = matchSegment(cursors, key, (size_t)(stream.getReader().getAddress() - key), childCursors, hasChildren);
+
+			stream.readPositionAfterChar(':');
+			stream.skipCommentsAndWhitespaces();
+			if (leafFields != 0 || hasChildren)
+				decodeValue(stream, output, childCursors, leafFields);
+			else
+				skipValue(stream);
+		}
+		stream.readNextPosition(); //after '}'
+	}
+
+	void decodeElements(Stream& stream, StructType& output, const PathCursors& cursors) const
+	{
+		stream.readNextPosition(); //after '['
+		for (int index = 0; skipToValue(stream, ']'); index++)
+		{
+			char segment[16];
+			auto numBytes = (size_t)snprintf(segment, sizeof(segment), "[%d]", index);
+			PathCursors childCursors;
+			bool hasChildren = false;
+			auto leafFields = matchSegment(cursors, segment, numBytes, childCursors, hasChildren);
+
+			if (leafFields != 0 || hasChildren)
+				decodeValue(stream, output, childCursors, leafFields);
+			else
+				skipValue(stream);
+		}
+		stream.readNextPosition(); //after ']'
+	}
+
+	//skips whitespaces, commas and comments before a property or element
+	//@return false at the scope's closing char (or the end of the text)
+	static bool skipToValue(Stream& stream, char closeChar)
+	{
+		do
+		{
+			stream.skipWhitespacesAndCommas();
+		} while (stream.skipComment());
+		return !stream.isAtChar(closeChar) && !stream.isEndOfJson();
+	}
+
+	static void skipValue(Stream& stream)
+	{
+		switch (getTypeFromChar(stream.getCurrentChar()))
+		{
+			case Type::Object:
+			case Type::Array:  stream.skipScope(true); break;
+			case Type::String: stream.skipString(true); break;
+			case Type::Number: stream.skipNumber(true); break;
+			case Type::Bool:   stream.skipBool(true); break;
+			case Type::Null:   stream.skipNull(true); break;
+			default: jassertfalse; stream.readNextPosition(); break; //unexpected char
+		}
+	}
+
+	template<size_t... indices>
+	void readFields(StructType& output, juce::uint64 fields, Type type, const char* text, size_t numBytes, std::index_sequence<indices...>) const
+	{
+		((fields & ((juce::uint64)1 << indices) ? readValue(output.*std::get<indices>(m_fields).member, type, text, numBytes) : void()), ...);
+	}
+
+	template<class MemberType>
+	static void readValue(MemberType& member, Type type, const char* text, size_t numBytes)
+	{
+		if constexpr (std::is_same<MemberType, juce::String>::value)
+		{
+			if (type == Type::String)
+				member = juce::String::fromUTF8(text, (int)numBytes);
+		}
+		else if constexpr (std::is_same<MemberType, bool>::value)
+		{
+			if (type == Type::Bool)
+				member = *text == 't';
+		}
+		else if constexpr (std::is_integral<MemberType>::value)
+		{
+			if (type != Type::Number)
+				return;
+
+			//up to 18 digits is the usual case, anything else (fractions, exponents, longer integers) goes through the double
+			bool isNegative = *text == '-';
+			auto digitsStart = text + (isNegative ? 1 : 0);
+			juce::int64 value = 0;
+			for (auto reader = digitsStart; reader != text + numBytes; reader++)
+			{
+				if (*reader < '0' || *reader > '9' || reader - digitsStart == 18)
+				{
+					//saturated, casting a double that's out of the member's range is undefined
+					juce::CharPointer_UTF8 doubleText(text);
+					auto doubleValue = juce::CharacterFunctions::readDoubleValue(doubleText);
+					if (!(doubleValue > (double)std::numeric_limits<MemberType>::lowest()))
+						member = std::numeric_limits<MemberType>::lowest();
+					else if (!(doubleValue < (double)std::numeric_limits<MemberType>::max()))
+						member = std::numeric_limits<MemberType>::max();
+					else
+						member = (MemberType)doubleValue;
+					return;
+				}
+				value = value * 10 + (*reader - '0');
+			}
+			//saturated to the member's range the same way, unsigned members get 0 for negative numbers
+			if (isNegative)
+			{
+				if constexpr (std::is_unsigned<MemberType>::value)
+					member = 0;
+				else
+					member = -value < (juce::int64)std::numeric_limits<MemberType>::lowest() ? std::numeric_limits<MemberType>::lowest() : (MemberType)-value;
+			}
+			else
+				member = (juce::uint64)value > (juce::uint64)std::numeric_limits<MemberType>::max() ? std::numeric_limits<MemberType>::max() : (MemberType)value;
+		}
+		else if constexpr (std::is_floating_point<MemberType>::value)
+		{
+			if (type == Type::Number)
+			{
+				juce::CharPointer_UTF8 doubleText(text);
+				member = (MemberType)juce::CharacterFunctions::readDoubleValue(doubleText);
+			}
+		}
+		else
+			static_assert(std::is_same<MemberType, juce::String>::value, "members can be juce::String, bool, integers or floating point");
+	}
+
+	std::tuple<Fields...> m_fields;
+	std::array<const char*, numFields> m_paths;
+};
+
+template<class StructType, class... Fields>
+constexpr Binding<StructType, Fields...> makeBinding(Fields... fields) { return Binding<StructType, Fields...>(fields...); }
+
+} //namespace json
@@ -0,0 +1,224 @@
+#include "JsonFormatRules.h"
+#include "JsonTape.h"
+
+namespace json
+{
+//rules that used to be hard-coded in Tree::createFormat()
+static const char* defaultFormatRules = R"json([
+    {"Path": "ActivationEventComparators/**", "Format": "Preserve"},
+    {"Path": "ActivationEventComparator/**", "Format": "Preserve"},
+    {"Path": "StoredVariableDescTokens/[]", "Type": "Object", "Format": "Collapsed"},
+    {"Path": "FriendlyAttackTileEffects", "Type": "Array", "Format": "Expanded"},
+    {"Path": "AbilitySlots", "Type": "Array", "Format": "Collapsed", "MaxSize": 1, "NoExtras": true},
+    {"Path": "AbilityUpgradeStrength", "Type": "Array", "Format": "Collapsed", "MaxSize": 1, "NoExtras": true}
+])json";
+
+bool FormatRules::loadFromFile(const juce::File& rulesFile)
+{
+    if (!rulesFile.existsAsFile())
+        return false;
+    return loadFromText(rulesFile.loadFileAsString());
+}
+
+bool FormatRules::loadFromText(const juce::String& rulesJson)
+{
+    Stream stream(rulesJson, true);
+    Tape tape(&stream);
+    if (!tape.getBase().isType(Type::Array))
+        return false;
+
+    juce::Array<Rule> rules;
+    for (auto ruleValue : tape.getBase())
+    {
+        auto path = ruleValue["Path"];
+        auto format = ruleValue["Format"];
+        if (!path.isType(Type::String) || !format.isType(Type::String))
+        {
+            jassertfalse; //every rule needs a path and a format
+            continue;
+        }
+
+        Rule newRule;
+        newRule.path = juce::StringArray::fromTokens(path.getString(), "/", "");
+        newRule.path.removeEmptyStrings();
+
+        auto formatString = format.getString();
+        if (formatString == "Collapsed")
+            newRule.format = Format::Collapsed;
+        else if (formatString == "Expanded")
+            newRule.format = Format::Expanded;
+        else if (formatString == "Preserve")
+            newRule.format = Format::Preserve;
+        else
+            jassertfalse; //unknown format
+
+        auto type = ruleValue["Type"];
+        if (type.isType(Type::String))
+        {
+            if (type.getString() == "Object")
+                newRule.type = Type::Object;
+            else if (type.getString() == "Array")
+                newRule.type = Type::Array;
+        }
+
+        auto maxSize = ruleValue["MaxSize"];
+        if (maxSize.isType(Type::Number))
+            newRule.maxSize = maxSize.getIntValue();
+
+        auto noExtras = ruleValue["NoExtras"];
+        if (noExtras.isType(Type::Bool))
+            newRule.requireNoExtras = noExtras.getBool();
+
+        rules.add(newRule);
+    }
+
+    setRules(rules);
+    return true;
+}
+
+void FormatRules::setRules(const juce::Array<Rule>& rules)
+{
+    m_rules = rules;
+    m_acceptBits.clear();
+    m_keyIds.clear();
+    m_keyMasks.clear();
+    m_startMask = m_starMask = m_elementMask = m_anyKeyMask = m_acceptMask = State();
+
+    auto setBit = [](State& mask, int bit) { mask.words[bit / 64] |= (juce::uint64)1 << (bit % 64); };
+
+    int nextBit = 0;
+    for (auto& rule : m_rules)
+    {
+        //consecutive "**" steps are the same as one
+        juce::StringArray steps;
+        for (auto& step : rule.path)
+        {
+            if (step != "**" || steps.isEmpty() || steps[steps.size() - 1] != "**")
+                steps.add(step);
+        }
+
+        //one bit per step plus one for the accepting state, all in the same word
+        int bitCount = steps.size() + 1;
+        if (bitCount > 64)
+        {
+            jassertfalse; //path is too long
+            m_acceptBits.add(-1);
+            continue;
+        }
+        if (nextBit % 64 + bitCount > 64)
+            nextBit = (nextBit / 64 + 1) * 64;
+        if (nextBit + bitCount > State::maxWords * 64)
+        {
+            jassertfalse; //too many rules
+            m_acceptBits.add(-1);
+            continue;
+        }
+
+        int startBit = nextBit;
+        setBit(m_startMask, startBit);
+        for (int i = 0; i < steps.size(); i++)
+        {
+            int stepBit = startBit + i;
+            if (steps[i] == "**")
+            {
+                setBit(m_starMask, stepBit);
+            }
+            else if (steps[i] == "[]")
+            {
+                setBit(m_elementMask, stepBit + 1);
+            }
+            else if (steps[i] == "*")
+            {
+                setBit(m_anyKeyMask, stepBit + 1);
+            }
+            else
+            {
+                if (!m_keyIds.contains(steps[i]))
+                {
+                    m_keyIds.set(steps[i], (int)m_keyMasks.size());
+                    m_keyMasks.emplace_back();
+                }
+                setBit(m_keyMasks[(size_t)m_keyIds[steps[i]]], stepBit + 1);
+            }
+        }
+        setBit(m_acceptMask, startBit + steps.size());
+        m_acceptBits.add(startBit + steps.size());
+
+        nextBit = startBit + bitCount;
+    }
+    m_numWords = (nextBit + 63) / 64;
+
+    //"*" matches every key
+    for (auto& keyMask : m_keyMasks)
+    {
+        for (int w = 0; w < m_numWords; w++)
+            keyMask.words[w] |= m_anyKeyMask.words[w];
+    }
+}
+
+const FormatRules& FormatRules::getDefault()
+{
+    static FormatRules defaultRules(juce::String::fromUTF8(defaultFormatRules));
+    return defaultRules;
+}
+
+FormatRules::State FormatRules::getStartState() const
+{
+    State output = m_startMask;
+    closeStarSteps(output);
+    return output;
+}
+
+FormatRules::State FormatRules::enterProperty(const State& state, int keyId) const
+{
+    if (keyId < 0)
+        return step(state, m_anyKeyMask);
+    return step(state, m_keyMasks[(size_t)keyId]);
+}
+
+FormatRules::State FormatRules::step(const State& state, const State& stepMask) const
+{
+    //an active step moves to the next bit if it matches, "**" steps also stay active
+    //every rule can start at any depth, so the first steps are always active
+    State output;
+    for (int w = 0; w < m_numWords; w++)
+        output.words[w] = ((state.words[w] << 1) & stepMask.words[w]) | (state.words[w] & m_starMask.words[w]) | m_startMask.words[w];
+    closeStarSteps(output);
+    return output;
+}
+
+void FormatRules::closeStarSteps(State& state) const
+{
+    //"**" can match no steps, so it activates the step after it (never the next rule's bits, it's never a rule's last bit)
+    for (int w = 0; w < m_numWords; w++)
+        state.words[w] |= (state.words[w] & m_starMask.words[w]) << 1;
+}
+
+FormatRules::Format FormatRules::findFormat(const State& state, Type scopeType, int size, bool containsExtras) const
+{
+    bool anyAccepted = false;
+    for (int w = 0; w < m_numWords; w++)
+        anyAccepted |= (state.words[w] & m_acceptMask.words[w]) != 0;
+    if (!anyAccepted)
+        return Format::None;
+
+    for (int i = 0; i < m_rules.size(); i++)
+    {
+        int acceptBit = m_acceptBits[i];
+        if (acceptBit < 0 || (state.words[acceptBit / 64] & ((juce::uint64)1 << (acceptBit % 64))) == 0)
+            continue;
+
+        auto& rule = m_rules.getReference(i);
+        if (rule.type != Type::None && rule.type != scopeType)
+            continue;
+        if (rule.maxSize >= 0 && size > rule.maxSize)
+            continue;
+        if (rule.requireNoExtras && containsExtras)
+            continue;
+
+        return rule.format;
+    }
+    return Format::None;
+}
+
+} //namespace json
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "JsonStream.h"
+
+namespace json
+{
+
+//one bit per rule step, rules don't cross words
+struct FormatRuleState
+{
+	static constexpr int maxWords = 8;
+	juce::uint64 words[maxWords] = {};
+};
+
+//layout rules for Tree's formatter
+//
+//a rule's path is matched against the end of a scope's path from the root, which is made of property keys
+//and "[]" for array elements. e.g. the objects in "Items": [{...}] have the path .../Items/[]
+//path steps: a key, "*" any key, "[]" any array element, "**" any number of steps (including none)
+//
+//all rules are compiled into one bit-parallel matcher, the formatter steps its State once per property/element,
+//so the cost per entity doesn't grow with the number of rules
+class FormatRules
+{
+public:
+	//==============================================================================
+	enum class Format : uint8_t { None, Collapsed, Expanded, Preserve };
+
+	struct Rule
+	{
+		juce::StringArray path;
+		//Type::None matches objects and arrays
+		Type type = Type::None;
+		Format format = Format::None;
+		//max property/element count, -1 for no limit
+		int maxSize = -1;
+		bool requireNoExtras = false;
+	};
+
+	typedef FormatRuleState State;
+
+	//==============================================================================
+	FormatRules() {}
+	FormatRules(const juce::Array<Rule>& rules) { setRules(rules); }
+	FormatRules(const juce::String& rulesJson) { loadFromText(rulesJson); }
+
+	//json array of rules, e.g. [{"Path": "Items/[]", "Type": "Object", "Format": "Collapsed", "MaxSize": 2, "NoExtras": true}]
+	//"Format" is "Collapsed", "Expanded" or "Preserve" (keeps the format of the source text)
+	bool loadFromFile(const juce::File& rulesFile);
+	bool loadFromText(const juce::String& rulesJson);
+
+	void setRules(const juce::Array<Rule>& rules);
+	const juce::Array<Rule>& getRules() const { return m_rules; }
+
+	//the rules the formatter has always used for our data files
+	static const FormatRules& getDefault();
+
+	//==============================================================================
+	//matching
+
+	//-1 if no rule uses the key
+	int getKeyId(const juce::String& key) const { return m_keyIds.contains(key) ? m_keyIds[key] : -1; }
+
+	State getStartState() const;
+	//steps from a property into its value
+	State enterProperty(const State& state, const juce::String& key) const { return enterProperty(state, getKeyId(key)); }
+	State enterProperty(const State& state, int keyId) const;
+	//steps from an array into its elements
+	State enterElement(const State& state) const { return step(state, m_elementMask); }
+
+	//format of the first rule that matches the scope at state
+	Format findFormat(const State& state, Type scopeType, int size, bool containsExtras) const;
+
+private:
+	//==============================================================================
+	State step(const State& state, const State& stepMask) const;
+	void closeStarSteps(State& state) const;
+
+	juce::Array<Rule> m_rules;
+	//bit of each rule's final step, -1 if the rule wasn't compiled
+	juce::Array<int> m_acceptBits;
+	int m_numWords = 0;
+
+	//bit of each rule's first step
+	State m_startMask;
+	//steps that are "**", they stay active and also activate the next step
+	State m_starMask;
+	//bit after each "[]" step
+	State m_elementMask;
+	//bit after each "*" step
+	State m_anyKeyMask;
+	State m_acceptMask;
+
+	juce::HashMap<juce::String, int> m_keyIds;
+	//bits after each step matching the key (includes m_anyKeyMask), indexed by key id
+	std::vector<State> m_keyMasks;
+
+	//==============================================================================
+	JUCE_LEAK_DETECTOR(FormatRules)
+};
+
+} //namespace json
@@ -0,0 +1,82 @@
+#include "JsonLines.h"
+
+namespace json
+{
+std::vector<LineReader::Chunk> LineReader::splitIntoChunks(juce::ThreadPool* threadPool) const
+{
+    auto textStart = m_text.toRawUTF8();
+    auto textEnd = textStart + m_text.getNumBytesAsUTF8();
+    auto numTextBytes = (size_t)(textEnd - textStart);
+
+    std::vector<Chunk> chunks;
+    if (threadPool == nullptr || threadPool->getNumThreads() < 2 || numTextBytes < (size_t)Tree::parallelMinBytes)
+    {
+        chunks.push_back({ textStart, textEnd, 0 });
+        return chunks;
+    }
+
+    //a chunk ends after the first newline past its share of the text
+    auto chunkBytes = numTextBytes / (size_t)(threadPool->getNumThreads() * 4);
+    for (auto chunkStart = textStart; chunkStart < textEnd; )
+    {
+        auto chunkEnd = textEnd;
+        if ((size_t)(textEnd - chunkStart) > chunkBytes)
+        {
+            auto newLine = (const char*)memchr(chunkStart + chunkBytes, '\n', (size_t)(textEnd - chunkStart) - chunkBytes);
+            if (newLine != nullptr)
+                chunkEnd = newLine + 1;
+        }
+        chunks.push_back({ chunkStart, chunkEnd, 0 });
+        chunkStart = chunkEnd;
+    }
+    return chunks;
+}
+
+void LineReader::readChunks(std::vector<Chunk> chunks, juce::ThreadPool* threadPool, const ChunkDecoder& decodeLine) const
+{
+    if (chunks.size() == 1)
+    {
+        readChunk(0, chunks[0], decodeLine);
+        return;
+    }
+
+    //the chunks' newlines are counted first, so every chunk knows the index of its first line
+    std::vector<size_t> numNewLines(chunks.size(), 0);
+    runParallel(*threadPool, (int)chunks.size(), [&](int i)
+    {
+        auto& chunk = chunks[(size_t)i];
+        for (auto reader = chunk.start; (reader = (const char*)memchr(reader, '\n', (size_t)(chunk.end - reader))) != nullptr; reader++)
+            numNewLines[(size_t)i]++;
+    });
+    for (size_t i = 1; i < chunks.size(); i++)
+        chunks[i].firstLineIndex = chunks[i - 1].firstLineIndex + numNewLines[i - 1];
+
+    runParallel(*threadPool, (int)chunks.size(), [&](int i)
+    {
+        readChunk((size_t)i, chunks[(size_t)i], decodeLine);
+    });
+}
+
+void LineReader::readChunk(size_t chunkIndex, const Chunk& chunk, const ChunkDecoder& decodeLine) const
+{
+    Stream stream(m_text, true);
+    auto lineIndex = chunk.firstLineIndex;
+    for (auto lineStart = chunk.start; lineStart < chunk.end; lineIndex++)
+    {
+        auto lineEnd = (const char*)memchr(lineStart, '\n', (size_t)(chunk.end - lineStart));
+        if (lineEnd == nullptr)
+            lineEnd = chunk.end;
+
+        auto valueStart = lineStart;
+        while (valueStart != lineEnd && (*valueStart == ' ' || *valueStart == '\t' || *valueStart == '\r'))
+            valueStart++;
+        if (valueStart != lineEnd)
+        {
+            stream.goToAddress(valueStart, 0);
+            decodeLine(chunkIndex, lineIndex, stream);
+        }
+        lineStart = lineEnd + 1;
+    }
+}
+
+} //namespace json
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "JsonStream.h"
+#include "JsonBinding.h"
+
+namespace json
+{
+
+//reads newline-delimited json (NDJSON / JSON Lines), every line is its own document
+//big texts are split into chunks at newlines, which are read concurrently on a thread pool, each chunk with one Stream
+//(the stream is moved from line to line, there's no Stream per line). results keep the line order
+class LineReader
+{
+public:
+	//==============================================================================
+	LineReader(const juce::File& file) : LineReader(file.loadFileAsString()) {}
+	LineReader(juce::String text) : m_text(text) {}
+
+	//lineIndex counts every line of the text (from 0), lines with only whitespace are skipped
+	//the stream is at the line's first char and its read positions count from there, so Positions made on one line
+	//can't be used on another
+	typedef std::function<void(size_t lineIndex, Stream& stream)> LineDecoder;
+
+	//with a thread pool, decodeLine is called from several threads at once (lines of a chunk are in order)
+	void forEachLine(const LineDecoder& decodeLine, juce::ThreadPool* threadPool = nullptr) const
+	{
+		readChunks(splitIntoChunks(threadPool), threadPool, [&](size_t, size_t lineIndex, Stream& stream) { decodeLine(lineIndex, stream); });
+	}
+
+	//decodes every line's record with the binding, in line order (lines that aren't objects or arrays are left out)
+	template<class StructType, class... Fields>
+	vArray<StructType> decode(const Binding<StructType, Fields...>& binding, juce::ThreadPool* threadPool = nullptr) const
+	{
+		auto chunks = splitIntoChunks(threadPool);
+		std::vector<vArray<StructType>> chunkRecords(chunks.size());
+		readChunks(chunks, threadPool, [&](size_t chunkIndex, size_t, Stream& stream)
+		{
+			StructType record;
+			if (binding.decode(stream, record))
+				chunkRecords[chunkIndex].add(std::move(record));
+		});
+
+		vArray<StructType> output;
+		size_t numRecords = 0;
+		for (auto& records : chunkRecords)
+			numRecords += records.size();
+		output.preallocate(numRecords);
+		for (auto& records : chunkRecords)
+		{
+			for (auto& record : records)
+				output.add(std::move(record));
+		}
+		return output;
+	}
+
+	const juce::String& getText() const { return m_text; }
+
+private:
+	//==============================================================================
+	struct Chunk
+	{
+		const char* start;
+		const char* end;
+		//line index of the chunk's first line, counted by readChunks()
+		size_t firstLineIndex;
+	};
+	typedef std::function<void(size_t chunkIndex, size_t lineIndex, Stream& stream)> ChunkDecoder;
+
+	//one chunk without a thread pool or for small texts, chunks start right after a newline
+	std::vector<Chunk> splitIntoChunks(juce::ThreadPool* threadPool) const;
+	void readChunks(std::vector<Chunk> chunks, juce::ThreadPool* threadPool, const ChunkDecoder& decodeLine) const;
+	void readChunk(size_t chunkIndex, const Chunk& chunk, const ChunkDecoder& decodeLine) const;
+
+	juce::String m_text;
+
+	//==============================================================================
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LineReader)
+};
+
+} //namespace json
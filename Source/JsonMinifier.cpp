@@ -0,0 +1,301 @@
+#include "JsonMinifier.h"
+
+namespace json
+{
+Minifier::Minifier(Stream& input, bool sortKeys) :
+    m_text(input.getEntireJsonText()),
+    m_sortKeys(sortKeys)
+{
+    m_reader = m_text.toRawUTF8();
+    m_end = m_reader + m_text.getNumBytesAsUTF8();
+}
+
+bool Minifier::write(juce::OutputStream& output)
+{
+    m_reader = m_text.toRawUTF8();
+    skipIgnored();
+    if (m_reader == m_end || !writeValue(output, 0))
+        return false;
+
+    skipIgnored();
+    return m_reader == m_end;
+}
+
+juce::String Minifier::toString()
+{
+    juce::MemoryOutputStream output(m_text.getNumBytesAsUTF8());
+    if (!write(output))
+        return juce::String();
+    return output.toUTF8();
+}
+
+bool Minifier::isEqualJsonData(Stream& stream1, Stream& stream2, bool sortKeys)
+{
+    Minifier minifier1(stream1, sortKeys);
+    Minifier minifier2(stream2, sortKeys);
+    juce::MemoryOutputStream output1, output2;
+    if (!minifier1.write(output1) || !minifier2.write(output2))
+        return false;
+    return output1.getDataSize() == output2.getDataSize() && memcmp(output1.getData(), output2.getData(), output1.getDataSize()) == 0;
+}
+
+bool Minifier::writeValue(juce::OutputStream& output, int depth)
+{
+    if (m_reader == m_end)
+        return false;
+
+    switch (*m_reader)
+    {
+        case '{': return m_sortKeys ? writeSortedObject(output, depth) : writeObject(output, depth);
+        case '[': return writeArray(output, depth);
+        case '\"':
+        {
+            auto length = getStringLength();
+            if (length == 0)
+                return false;
+            output.write(m_reader, length);
+            m_reader += length;
+            return true;
+        }
+        case 't': return writeLiteral(output, "true", 4);
+        case 'f': return writeLiteral(output, "false", 5);
+        case 'n': return writeLiteral(output, "null", 4);
+        default:
+        {
+            //numbers are copied as they are written, once their grammar is checked
+            auto length = getNumberLength();
+            if (length == 0)
+                return false;
+            output.write(m_reader, length);
+            m_reader += length;
+            return true;
+        }
+    }
+}
+
+bool Minifier::writeLiteral(juce::OutputStream& output, const char* literal, size_t length)
+{
+    if ((size_t)(m_end - m_reader) < length || memcmp(m_reader, literal, length) != 0)
+        return false;
+    output.write(literal, length);
+    m_reader += length;
+    return true;
+}
+
+bool Minifier::writeObject(juce::OutputStream& output, int depth)
+{
+    m_reader++; //after '{'
+    output.writeByte('{');
+
+    skipIgnored();
+    if (m_reader != m_end && *m_reader != '}')
+    {
+        while (true)
+        {
+            auto keyLength = getStringLength();
+            if (keyLength == 0)
+                return false;
+            output.write(m_reader, keyLength);
+            m_reader += keyLength;
+
+            skipIgnored();
+            if (!readChar(':'))
+                return false;
+            output.writeByte(':');
+            skipIgnored();
+
+            if (!writeValue(output, depth + 1))
+                return false;
+
+            //properties are separated by exactly one comma, a trailing one fails at the next key
+            skipIgnored();
+            if (!readChar(','))
+                break;
+            output.writeByte(',');
+            skipIgnored();
+        }
+    }
+    if (!readChar('}'))
+        return false;
+    output.writeByte('}');
+    return true;
+}
+
+bool Minifier::writeSortedObject(juce::OutputStream& output, int depth)
+{
+    m_reader++; //after '{'
+
+    if ((int)m_sortBuffers.size() <= depth)
+        m_sortBuffers.resize((size_t)depth + 1);
+    if (m_sortBuffers[(size_t)depth] == nullptr)
+        m_sortBuffers[(size_t)depth] = std::make_unique<SortBuffer>();
+    auto& buffer = *m_sortBuffers[(size_t)depth];
+    buffer.values.reset();
+    buffer.entries.clear();
+
+    //the values are minified into the buffer, the keys stay in the source text
+    skipIgnored();
+    if (m_reader != m_end && *m_reader != '}')
+    {
+        while (true)
+        {
+            auto keyLength = getStringLength();
+            if (keyLength == 0)
+                return false;
+            SortEntry entry{ m_reader + 1, keyLength - 2, buffer.values.getDataSize(), 0 };
+            m_reader += keyLength;
+
+            skipIgnored();
+            if (!readChar(':'))
+                return false;
+            skipIgnored();
+
+            if (!writeValue(buffer.values, depth + 1))
+                return false;
+            entry.valueLength = buffer.values.getDataSize() - entry.valueOffset;
+            buffer.entries.push_back(entry);
+
+            skipIgnored();
+            if (!readChar(','))
+                break;
+            skipIgnored();
+        }
+    }
+    if (!readChar('}'))
+        return false;
+
+    std::stable_sort(buffer.entries.begin(), buffer.entries.end(), [](const SortEntry& a, const SortEntry& b)
+    {
+        auto compare = memcmp(a.key, b.key, juce::jmin(a.keyLength, b.keyLength));
+        return compare != 0 ? compare < 0 : a.keyLength < b.keyLength;
+    });
+
+    auto values = (const char*)buffer.values.getData();
+    output.writeByte('{');
+    for (size_t i = 0; i < buffer.entries.size(); i++)
+    {
+        auto& entry = buffer.entries[i];
+        if (i > 0)
+            output.writeByte(',');
+        output.writeByte('\"');
+        output.write(entry.key, entry.keyLength);
+        output.write("\":", 2);
+        output.write(values + entry.valueOffset, entry.valueLength);
+    }
+    output.writeByte('}');
+    return true;
+}
+
+bool Minifier::writeArray(juce::OutputStream& output, int depth)
+{
+    m_reader++; //after '['
+    output.writeByte('[');
+
+    skipIgnored();
+    if (m_reader != m_end && *m_reader != ']')
+    {
+        while (true)
+        {
+            if (!writeValue(output, depth + 1))
+                return false;
+
+            skipIgnored();
+            if (!readChar(','))
+                break;
+            output.writeByte(',');
+            skipIgnored();
+        }
+    }
+    if (!readChar(']'))
+        return false;
+    output.writeByte(']');
+    return true;
+}
+
+size_t Minifier::getStringLength() const
+{
+    if (m_reader == m_end || *m_reader != '\"')
+        return 0;
+
+    for (auto reader = m_reader + 1; reader < m_end; reader++)
+    {
+        if (*reader == '\\') //escape sequence
+            reader++;
+        else if (*reader == '\"')
+            return (size_t)(reader + 1 - m_reader);
+    }
+    return 0;
+}
+
+size_t Minifier::getNumberLength() const
+{
+    //-?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+    auto reader = m_reader;
+    auto isDigit = [&] { return reader != m_end && *reader >= '0' && *reader <= '9'; };
+    auto skipDigits = [&]
+    {
+        auto digitsStart = reader;
+        while (isDigit())
+            reader++;
+        return reader != digitsStart;
+    };
+
+    if (reader != m_end && *reader == '-')
+        reader++;
+    if (reader != m_end && *reader == '0')
+        reader++;
+    else if (!skipDigits())
+        return 0;
+
+    if (reader != m_end && *reader == '.')
+    {
+        reader++;
+        if (!skipDigits())
+            return 0;
+    }
+    if (reader != m_end && (*reader == 'e' || *reader == 'E'))
+    {
+        reader++;
+        if (reader != m_end && (*reader == '+' || *reader == '-'))
+            reader++;
+        if (!skipDigits())
+            return 0;
+    }
+    return (size_t)(reader - m_reader);
+}
+
+void Minifier::skipIgnored()
+{
+    while (m_reader != m_end)
+    {
+        char currentChar = *m_reader;
+        if (currentChar == ' ' || currentChar == '\t' || currentChar == '\r' || currentChar == '\n')
+        {
+            m_reader++;
+        }
+        else if (currentChar == '/' && m_reader + 1 != m_end && m_reader[1] == '/') //single-line comment
+        {
+            while (m_reader != m_end && *m_reader != '\n')
+                m_reader++;
+        }
+        else if (currentChar == '/' && m_reader + 1 != m_end && m_reader[1] == '*') //multi-line comment
+        {
+            m_reader += 2;
+            while (m_reader + 1 < m_end && !(m_reader[0] == '*' && m_reader[1] == '/'))
+                m_reader++;
+            m_reader = juce::jmin(m_reader + 2, m_end);
+        }
+        else
+            return;
+    }
+}
+
+bool Minifier::readChar(char expectedChar)
+{
+    if (m_reader == m_end || *m_reader != expectedChar)
+        return false;
+    m_reader++;
+    return true;
+}
+
+} //namespace json
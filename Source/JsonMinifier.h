@@ -0,0 +1,69 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "JsonStream.h"
+
+namespace json
+{
+
+//writes a stream's json as canonical minified json in one pass, without building a Tree
+//comments and whitespace are dropped, strings and numbers are copied as they are written (escape sequences aren't changed)
+//the json is checked while it's copied (literals, number grammar, commas between values), write() fails on anything else
+//with sortKeys, each object's properties are sorted by their key's UTF-8 bytes (equal keys keep their order),
+//which needs each object to be buffered until it's closed, otherwise nothing is buffered
+class Minifier
+{
+public:
+	//==============================================================================
+	Minifier(Stream& input, bool sortKeys = false);
+
+	//@return false if the json is malformed, output stops there
+	bool write(juce::OutputStream& output);
+	//empty if the json is malformed
+	juce::String toString();
+
+	//equal if their minified json is the same, e.g. files that only differ by formatting or comments
+	static bool isEqualJsonData(Stream& stream1, Stream& stream2, bool sortKeys = false);
+
+private:
+	//==============================================================================
+	bool writeValue(juce::OutputStream& output, int depth);
+	bool writeObject(juce::OutputStream& output, int depth);
+	bool writeSortedObject(juce::OutputStream& output, int depth);
+	bool writeArray(juce::OutputStream& output, int depth);
+	//true, false or null, spelled exactly
+	bool writeLiteral(juce::OutputStream& output, const char* literal, size_t length);
+	//@return the string's length with quotes, 0 if it isn't closed
+	size_t getStringLength() const;
+	//@return the number's length, 0 if it isn't a valid json number
+	size_t getNumberLength() const;
+	//whitespaces and comments
+	void skipIgnored();
+	//returns false if the current char isn't expectedChar
+	bool readChar(char expectedChar);
+
+	struct SortEntry
+	{
+		const char* key;
+		size_t keyLength;
+		size_t valueOffset;
+		size_t valueLength;
+	};
+	struct SortBuffer
+	{
+		juce::MemoryOutputStream values;
+		std::vector<SortEntry> entries;
+	};
+
+	const char* m_reader;
+	const char* m_end;
+	juce::String m_text;
+	bool m_sortKeys;
+	//one per depth, reused by the objects at that depth
+	std::vector<std::unique_ptr<SortBuffer>> m_sortBuffers;
+
+	//==============================================================================
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Minifier)
+};
+
+} //namespace json
@@ -1,4 +1,5 @@
 #include "JsonStream.h"
+#include "JsonFormatRules.h"
 
 namespace json
 {
@@ -148,6 +149,52 @@ Position Stream::findProperty(Position& jsonObject, const juce::String& key)
     return Position();
 }
 
+Position Stream::findProperty(Position& jsonObject, const Key& key)
+{
+    if (!jsonObject.isType(Type::Object))
+        return Position();
+
+    goToPosition(jsonObject);
+    readNextPosition(); //after '{'
+
+    while (true)
+    {
+        do
+        {
+            skipWhitespacesAndCommas();
+        } while (skipComment());
+
+        if (m_currentChar != '\"')
+            return Position(); //key does not exist in current object
+
+        auto keyStart = m_reader.getAddress() + 1;
+        skipString(false);
+        bool isMatch = key.matches(keyStart, (size_t)(m_reader.getAddress() - keyStart));
+        readPositionAfterChar(':');
+        skipCommentsAndWhitespaces();
+
+        if (isMatch)
+        {
+            Position output(this);
+            output.type = getTypeFromChar(m_currentChar);
+            output.readPosition = m_readPosition; //start position of property's value ('{', '\"', '1', etc.)
+            setJsonGridPositions(output);
+            return output;
+        }
+
+        switch (getTypeFromChar(m_currentChar))
+        {
+            case Type::Object: skipObject(true); break;
+            case Type::Array: skipArray(true); break;
+            case Type::String: skipString(true); break;
+            case Type::Number: skipNumber(true); break;
+            case Type::Bool: skipBool(true); break;
+            case Type::Null: skipNull(true);  break;
+            default: jassertfalse; return Position();
+        }
+    }
+}
+
 Property Stream::getProperty(Position& jsonObject, const juce::String& key)
 {
     return Property(findProperty(jsonObject, key), key);
@@ -525,7 +572,7 @@ juce::String Stream::getNumber(Position& jsonNumber)
     goToPosition(jsonNumber);
 
     juce::String output;
-    while (m_reader.isDigit() || m_currentChar == '-' || m_currentChar == '.')
+    while (m_reader.isDigit() || m_currentChar == '-' || m_currentChar == '.' || m_currentChar == 'e' || m_currentChar == 'E' || m_currentChar == '+')
     {
         output += m_currentChar;
         readNextPosition();
@@ -537,7 +584,7 @@ juce::String Stream::getNumber()
     jassert(getTypeFromChar(m_currentChar) == Type::Number);
 
     juce::String output;
-    while (m_reader.isDigit() || m_currentChar == '-' || m_currentChar == '.')
+    while (m_reader.isDigit() || m_currentChar == '-' || m_currentChar == '.' || m_currentChar == 'e' || m_currentChar == 'E' || m_currentChar == '+')
     {
         output += m_currentChar;
         readNextPosition();
@@ -567,13 +614,17 @@ juce::String Stream::getComment()
     if (m_currentChar == '/') //single line comment
     {
         readNextPosition();
-        while (m_currentChar != '\n' && m_currentChar != '\r')
+        while (m_currentChar != '\n' && m_currentChar != '\r' && m_currentChar != 0)
         {
             output += m_currentChar;
             readNextPosition();
         }
-        if (m_currentChar != '\r')
+        //after the line feed, the next line's first char isn't skipped
+        if (m_currentChar == '\r')
             readNextPosition();
+        if (m_currentChar == '\n')
+            readNextPosition();
+        return output;
     }
     else if (m_currentChar == '*') //multi line comment
     {
@@ -653,20 +704,28 @@ ScopeFormat Stream::getScopeFormat(bool returnToStartPosition)
 
 void Stream::setData(int startPosition, int endPosition, const juce::String& newData, int setNewReaderPosition)
 {
+    auto textStart = m_jsonText.getCharPointer();
+    auto startByte = (size_t)((textStart + startPosition).getAddress() - textStart.getAddress());
+    auto oldEndByte = (size_t)((textStart + endPosition).getAddress() - textStart.getAddress());
+
     m_jsonText = m_jsonText.substring(0, startPosition) + newData + m_jsonText.substring(endPosition);
     m_reader = m_jsonText.begin() + setNewReaderPosition;
     jsonResized(startPosition, endPosition - startPosition + newData.length());
+    notifyEdit(startByte, oldEndByte, startByte + newData.getNumBytesAsUTF8());
 }
 
 void Stream::setString(Position& jsonProperty, const juce::String& newString)
 {
     jassert(!readOnly);
+    makeTextUnique();
     goToPosition(jsonProperty);
     jassert(getTypeFromChar(m_currentChar) == Type::String);
 
     int stringStartPosition = m_readPosition + 1; //frist string char
+    auto startByte = (size_t)(m_reader.getAddress() + 1 - m_jsonText.toRawUTF8());
     skipString(false);
     int currentStringLength = m_readPosition - stringStartPosition;
+    auto oldEndByte = (size_t)(m_reader.getAddress() - m_jsonText.toRawUTF8());
     //==============================================================================
     // Shrink Example ('.' null termination character, 's' allocated space (0xcd)):
     // 
@@ -806,19 +865,23 @@ void Stream::setString(Position& jsonProperty, const juce::String& newString)
         newStringReader++;
         readNextPosition();
     }
+    notifyEdit(startByte, oldEndByte, startByte + (size_t)newString.length());
 }
 //mostly copied from setString()
 void Stream::setInt(Position& jsonProperty, const juce::String& newInt)
 {
     jassert(!readOnly);
     jassert(newInt.isNotEmpty());
+    makeTextUnique();
 
     goToPosition(jsonProperty);
     jassert(getTypeFromChar(m_currentChar) == Type::Number);
     //readNextPosition(); //start of int value
 
     int stringStartPosition = m_readPosition; //first digit
+    auto startByte = (size_t)(m_reader.getAddress() - m_jsonText.toRawUTF8());
     skipInt(true);
+    auto oldEndByte = (size_t)(m_reader.getAddress() - m_jsonText.toRawUTF8());
     int currentDigitCount = m_readPosition - stringStartPosition;
     if (currentDigitCount > newInt.length())
     {
@@ -878,6 +941,7 @@ void Stream::setInt(Position& jsonProperty, const juce::String& newInt)
         newIntReader++;
         readNextPosition();
     }
+    notifyEdit(startByte, oldEndByte, startByte + (size_t)newInt.length());
 }
 
 void Stream::flushJson() { m_jsonFile.replaceWithText(m_jsonText); }
@@ -910,6 +974,23 @@ void Stream::removeResizeListener(Position* listener)
     }
 }
 
+void Stream::notifyEdit(size_t startByte, size_t oldEndByte, size_t newEndByte)
+{
+    for (auto listener : m_editListeners)
+        listener->jsonTextEdited(*this, startByte, oldEndByte, newEndByte);
+}
+
+void Stream::makeTextUnique()
+{
+    if (m_jsonText.getReferenceCount() <= 1)
+        return;
+
+    int readPosition = m_readPosition;
+    m_jsonText = juce::String::fromUTF8(m_jsonText.toRawUTF8(), (int)m_jsonText.getNumBytesAsUTF8());
+    goToJsonTextStart();
+    goToPosition(readPosition);
+}
+
 void Stream::jsonResized(int centerPosition, int shiftAmount)
 {
     if (shiftAmount <= 0)
@@ -942,6 +1023,31 @@ void Stream::goToPosition(int newPosition)
     m_readPosition = newPosition;
 }
 
+void Stream::goToPosition(const Stream& otherStream)
+{
+    jassert(m_jsonText.getCharPointer() == otherStream.m_jsonText.getCharPointer()); //not the same text
+    m_reader = otherStream.m_reader;
+    m_currentChar = otherStream.m_currentChar;
+    m_readPosition = otherStream.m_readPosition;
+}
+
+void Stream::goToAddress(const char* address)
+{
+    auto textStart = m_jsonText.getCharPointer();
+    jassert(address >= textStart.getAddress() && address <= textStart.getAddress() + m_jsonText.getNumBytesAsUTF8());
+    m_reader = juce::String::CharPointerType(const_cast<char*>(address));
+    m_currentChar = *address;
+    m_readPosition = (int)textStart.lengthUpTo(m_reader);
+}
+
+void Stream::goToAddress(const char* address, int readPosition)
+{
+    jassert(address >= m_jsonText.toRawUTF8()); //not in the stream's text (the end isn't checked, it would need a strlen)
+    m_reader = juce::String::CharPointerType(const_cast<char*>(address));
+    m_currentChar = *address;
+    m_readPosition = readPosition;
+}
+
 void Stream::goToJsonTextStart()
 {
     m_reader = m_jsonText.getCharPointer();
@@ -1164,9 +1270,10 @@ bool Stream::skipComment()
     readNextPosition();
     if (m_currentChar == '/') //single line comment
     {
-        while (m_currentChar != '\n')
+        while (m_currentChar != '\n' && m_currentChar != 0)
             readNextPosition();
-        readNextPosition(); //after comment
+        if (m_currentChar != 0)
+            readNextPosition(); //after comment
         return true;
     }
     else if (m_currentChar == '*') //multi line comment
@@ -1174,7 +1281,8 @@ bool Stream::skipComment()
         readNextPosition();
         while (true)
         {
-            readNextCharPosition('*'); //possible comment end
+            if (!tryReadNextCharPosition('*')) //possible comment end, or no end at all
+                return true;
             readNextPosition();
             if (m_currentChar == '/') //comment end
                 break;
@@ -1298,6 +1406,8 @@ void Stream::skipString(bool afterEndChar)
         {
             readNextPosition(); //skip escape sequences
         }
+        if (m_currentChar == 0) //no end quote, stays at the end of the text
+            return;
         readNextPosition();
     }
 }
@@ -1324,6 +1434,14 @@ void Stream::skipFloat(bool afterEndChar)
     {
         readNextPosition();
     }
+    if (m_currentChar == 'e' || m_currentChar == 'E') //exponent
+    {
+        readNextPosition();
+        if (m_currentChar == '+' || m_currentChar == '-')
+            readNextPosition();
+        while (m_reader.isDigit())
+            readNextPosition();
+    }
     if (!afterEndChar)
         readPreviousPosition();
 }
@@ -1338,8 +1456,8 @@ void Stream::skipBool(bool afterEndChar)
 
 void Stream::skipNull(bool afterEndChar)
 {
-    //"null" ends in 'l'
-    readNextCharPosition('l');
+    //"null" ends in 'l', skip to the second one
+    readNextPosition(3);
     if (afterEndChar)
         readNextPosition();
 }
@@ -1380,6 +1498,7 @@ Position::~Position()
 Position::operator bool() const { return isValid(); }
 
 Position Position::operator[](const juce::String& propertyKey) { return p_stream->getProperty(*this, propertyKey); }
+Position Position::operator[](const Key& propertyKey) { return p_stream->findProperty(*this, propertyKey); }
 Position Position::getProperty(const juce::String& propertyKey) { return p_stream->getProperty(*this, propertyKey); }
 
 juce::StringArray Position::getPropertyKeys() { return p_stream->getPropertyKeys(*this); }
@@ -1706,6 +1825,125 @@ Type getTypeFromChar(juce::juce_wchar startChar)
 }
 
 
+//==============================================================================
+
+void* Arena::allocate(size_t numBytes, size_t alignment)
+{
+    jassert(alignment > 0 && (alignment & (alignment - 1)) == 0); //must be a power of 2
+
+    auto alignedPosition = (char*)(((juce::pointer_sized_uint)m_blockPosition + alignment - 1) & ~(juce::pointer_sized_uint)(alignment - 1));
+    if (m_blockPosition == nullptr || alignedPosition + numBytes > m_blockEnd)
+    {
+        //allocations bigger than a block get their own block
+        size_t newBlockSize = juce::jmax(m_blockSize, numBytes + alignment);
+        m_blocks.emplace_back(newBlockSize);
+        m_blockPosition = m_blocks.back().get();
+        m_blockEnd = m_blockPosition + newBlockSize;
+        alignedPosition = (char*)(((juce::pointer_sized_uint)m_blockPosition + alignment - 1) & ~(juce::pointer_sized_uint)(alignment - 1));
+    }
+
+    m_blockPosition = alignedPosition + numBytes;
+    m_bytesUsed += numBytes;
+    return alignedPosition;
+}
+
+void Arena::release()
+{
+    while (m_destructors != nullptr)
+    {
+        auto destructor = m_destructors;
+        m_destructors = destructor->next;
+        destructor->destroy(destructor->object);
+    }
+
+    m_blocks.clear();
+    m_blockPosition = nullptr;
+    m_blockEnd = nullptr;
+    m_bytesUsed = 0;
+}
+
+void Arena::addDestructor(void* object, void (*destroy)(void*))
+{
+    auto destructor = (Destructor*)allocate(sizeof(Destructor), alignof(Destructor));
+    destructor->destroy = destroy;
+    destructor->object = object;
+    destructor->next = m_destructors;
+    m_destructors = destructor;
+}
+
+//==============================================================================
+
+KeyID KeyPool::intern(const char* utf8, size_t numBytes)
+{
+    //keep the load factor under 1/2
+    if ((m_keys.size() + 1) * 2 > m_slots.size())
+        grow();
+
+    auto hash = getHash(utf8, numBytes);
+    auto slot = findSlot(utf8, numBytes, hash);
+    if (m_slots[slot] != 0)
+        return m_slots[slot] - 1;
+
+    auto newId = (KeyID)m_keys.size();
+    m_keys.push_back(juce::String::fromUTF8(utf8, (int)numBytes));
+    m_hashes.push_back(hash);
+    m_slots[slot] = newId + 1;
+    return newId;
+}
+
+KeyID KeyPool::find(const char* utf8, size_t numBytes) const
+{
+    if (m_slots.empty())
+        return invalidKeyID;
+
+    auto slot = findSlot(utf8, numBytes, getHash(utf8, numBytes));
+    return m_slots[slot] - 1; //empty slot gives invalidKeyID
+}
+
+KeyID KeyPool::find(const Key& key) const
+{
+    if (m_slots.empty())
+        return invalidKeyID;
+
+    auto slot = findSlot(key.text, key.numBytes, key.hash);
+    return m_slots[slot] - 1; //empty slot gives invalidKeyID
+}
+
+juce::uint32 KeyPool::getHash(const char* utf8, size_t numBytes)
+{
+    //FNV-1a, same as Key::getHash()
+    return Key::getHash(utf8, numBytes);
+}
+
+size_t KeyPool::findSlot(const char* utf8, size_t numBytes, juce::uint32 hash) const
+{
+    auto mask = m_slots.size() - 1;
+    for (auto slot = hash & mask;; slot = (slot + 1) & mask)
+    {
+        auto slotValue = m_slots[slot];
+        if (slotValue == 0)
+            return slot;
+
+        auto& key = m_keys[slotValue - 1];
+        if (m_hashes[slotValue - 1] == hash && key.getNumBytesAsUTF8() == numBytes && memcmp(key.toRawUTF8(), utf8, numBytes) == 0)
+            return slot;
+    }
+}
+
+void KeyPool::grow()
+{
+    m_slots.assign(m_slots.empty() ? 64 : m_slots.size() * 2, 0);
+
+    auto mask = m_slots.size() - 1;
+    for (KeyID id = 0; id < (KeyID)m_keys.size(); id++)
+    {
+        auto slot = m_hashes[id] & mask;
+        while (m_slots[slot] != 0)
+            slot = (slot + 1) & mask;
+        m_slots[slot] = id + 1;
+    }
+}
+
 //==============================================================================
 
 bool Tree::isEqualJsonData(Stream& stream1, Stream& stream2, bool ignoreCommas)
@@ -1779,19 +2017,206 @@ bool Tree::isEqualJsonData(Stream& stream1, Stream& stream2, bool ignoreCommas)
 
 //==============================================================================
 
-void Tree::initialize()
+void Tree::initialize(juce::ThreadPool* threadPool)
 {
-    if (!isValid())
+    if (m_stream == nullptr || m_stream->getStart().isNotValid())
         return;
 
+    m_sourceText = m_stream->getEntireJsonText();
+    m_sourceBytes = m_sourceText.getNumBytesAsUTF8();
     m_stream->readOnly = true;
     m_stream->goToJsonTextStart();
-    initializeJson(m_base, initializeExtras(true));
+    m_newLineScanPosition = m_lastNewLine = m_stream->getReader().getAddress();
+
+    auto baseExtras = initializeExtras(true);
+    if (threadPool == nullptr || !initializeParallel(*threadPool, baseExtras))
+        initializeJson(m_base, baseExtras);
 
     m_stream->readOnly = false;
 }
 
-void Tree::initializeJson(Entity*& currentEntity, std::vector<Extra*>& extras)
+Tree::Tree(std::unique_ptr<Stream> chunkStream) : m_stream(chunkStream.get()), m_chunkStream(std::move(chunkStream)), m_isChunk(true)
+{
+}
+
+bool Tree::initializeParallel(juce::ThreadPool& threadPool, Extras baseExtras)
+{
+    auto& jsonText = m_stream->getEntireJsonText();
+    auto numTextBytes = jsonText.getNumBytesAsUTF8();
+    if (threadPool.getNumThreads() < 2 || numTextBytes < (size_t)parallelMinBytes || !m_stream->isAtScopeStart())
+        return false;
+
+    bool isObject = m_stream->isAtChar('{');
+    char closeChar = isObject ? '}' : ']';
+    auto scopeStart = m_stream->getReader().getAddress();
+    m_stream->readNextPosition(); //after '{' or '['
+
+    //skim the children to split them into chunks of about the same size
+    //a chunk starts right after the previous chunk's last child, so the extras before its first child belong to it
+    std::vector<std::unique_ptr<Tree>> chunks;
+    std::vector<int> chunkSizes;
+    auto chunkBytes = numTextBytes / (size_t)(threadPool.getNumThreads() * 4);
+    const char* chunkStart = nullptr;
+    auto addChunk = [&]
+    {
+        auto chunkStream = std::make_unique<Stream>(jsonText, true);
+        chunkStream->goToPosition(*m_stream);
+        chunks.push_back(std::unique_ptr<Tree>(new Tree(std::move(chunkStream))));
+        chunkSizes.push_back(0);
+        chunkStart = m_stream->getReader().getAddress();
+    };
+
+    addChunk();
+    while (true)
+    {
+        do
+        {
+            m_stream->skipWhitespacesAndCommas();
+        } while (m_stream->skipComment());
+
+        if (m_stream->isAtChar(closeChar) || m_stream->isEndOfJson())
+            break;
+
+        if (isObject)
+        {
+            m_stream->skipString(true); //key
+            m_stream->skipCommentsAndWhitespaces();
+            m_stream->readNextPosition(); //after ':'
+            m_stream->skipCommentsAndWhitespaces();
+        }
+        switch (getTypeFromChar(m_stream->getCurrentChar()))
+        {
+            case Type::Object:
+            case Type::Array:  m_stream->skipScope(true); break;
+            case Type::String: m_stream->skipString(true); break;
+            case Type::Number: m_stream->skipNumber(true); break;
+            case Type::Bool:   m_stream->skipBool(true); break;
+            case Type::Null:   m_stream->skipNull(true); break;
+            default: jassertfalse; m_stream->readNextPosition(); break; //unexpected char
+        }
+        chunkSizes.back()++;
+
+        if ((size_t)(m_stream->getReader().getAddress() - chunkStart) >= chunkBytes)
+            addChunk();
+    }
+    jassert(m_stream->isAtChar(closeChar)); //scope isn't closed
+
+    //the last child ended a chunk, so the chunk before it reads the end extras
+    if (chunks.size() > 1 && chunkSizes.back() == 0)
+    {
+        chunks.pop_back();
+        chunkSizes.pop_back();
+    }
+
+    int numChunks = (int)chunks.size();
+    std::vector<std::vector<Entity*>> chunkChildren((size_t)numChunks);
+    Extras endExtras;
+    runParallel(threadPool, numChunks, [&](int i)
+    {
+        chunks[(size_t)i]->initializeChunk(isObject, chunkSizes[(size_t)i], i == numChunks - 1, chunkChildren[(size_t)i], endExtras);
+    });
+
+    //each chunk has its own KeyPool, switch their KeyIDs to this tree's
+    std::vector<std::vector<KeyID>> keyIdMaps((size_t)numChunks);
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        auto& chunkKeys = chunks[i]->m_keys;
+        for (KeyID keyId = 0; keyId < (KeyID)chunkKeys.size(); keyId++)
+            keyIdMaps[i].push_back(m_keys.intern(chunkKeys.getKey(keyId)));
+    }
+    runParallel(threadPool, numChunks, [&](int i)
+    {
+        auto& keyIdMap = keyIdMaps[(size_t)i];
+        auto& chunkProperties = chunks[(size_t)i]->m_chunkProperties;
+        for (auto p : chunkProperties)
+            p->keyId = keyIdMap[p->keyId];
+        std::vector<Property*>().swap(chunkProperties);
+    });
+
+    //stitch the chunks' children into the base scope
+    if (isObject)
+    {
+        auto& baseObject = *m_arena.create<Object>();
+        for (auto& children : chunkChildren)
+        {
+            for (auto child : children)
+            {
+                child->parent = &baseObject;
+                baseObject.properties.add(&child->toProperty(), m_arena);
+                addChildFlags(baseObject, child->toProperty());
+            }
+        }
+        baseObject.endExtras = endExtras;
+        m_base = &baseObject;
+    }
+    else
+    {
+        auto& baseArray = *m_arena.create<Array>();
+        for (auto& children : chunkChildren)
+        {
+            for (auto child : children)
+            {
+                child->parent = &baseArray;
+                baseArray.elements.add(child, m_arena);
+                addChildFlags(baseArray, *child);
+            }
+        }
+        baseArray.endExtras = endExtras;
+        m_base = &baseArray;
+    }
+    if (endExtras.size() > 0)
+        m_base->flags |= containsExtrasFlag;
+    m_base->extras = baseExtras;
+
+    m_stream->readNextPosition(); //after '}' or ']'
+    setSourceRange(*m_base, scopeStart);
+    auto scopeFormat = getClosedScopeFormat(scopeStart, isObject ? m_base->toObject().properties.size() > 0 : m_base->toArray().elements.size() > 0);
+    if (isObject)
+        m_base->toObject().scopeFormat = scopeFormat;
+    else
+        m_base->toArray().scopeFormat = scopeFormat;
+
+    m_chunkTrees = std::move(chunks);
+    return true;
+}
+
+void Tree::initializeChunk(bool isObject, int numChildren, bool isLastChunk, std::vector<Entity*>& children, Extras& endExtras)
+{
+    //same text as the main tree's, so the source ranges line up
+    m_sourceText = m_stream->getEntireJsonText();
+    m_newLineScanPosition = m_lastNewLine = m_stream->getReader().getAddress();
+    children.reserve((size_t)numChildren);
+
+    //same as initializeJson() for a scope, without the scope's chars
+    auto extras = initializeExtras(false);
+    for (int i = 0; i < numChildren; i++)
+    {
+        if (isObject)
+        {
+            Property* newProperty = nullptr;
+            initializeJsonProperty(newProperty, extras);
+            children.push_back(newProperty);
+        }
+        else
+        {
+            Entity* newElement = nullptr;
+            initializeJson(newElement, extras);
+            children.push_back(newElement);
+        }
+
+        //the extras after a chunk's last child are read by the next chunk
+        if (i < numChildren - 1 || isLastChunk)
+            extras = initializeExtras(false);
+    }
+    if (isLastChunk)
+        endExtras = extras;
+
+    //the stream isn't needed after initializing
+    m_stream = nullptr;
+    m_chunkStream.reset();
+}
+
+void Tree::initializeJson(Entity*& currentEntity, Extras extras)
 {
     if (currentEntity)
     {
@@ -1803,11 +2228,14 @@ void Tree::initializeJson(Entity*& currentEntity, std::vector<Extra*>& extras)
                 Property* newProperty = nullptr;
                 initializeJsonProperty(newProperty, extras);
                 newProperty->parent = currentObject;
-                currentObject->properties.push_back(newProperty);
+                currentObject->properties.add(newProperty, *m_buildArena);
+                addChildFlags(*currentObject, *newProperty);
 
                 extras = initializeExtras(false);
             }
             currentObject->endExtras = extras;
+            if (extras.size() > 0)
+                currentObject->flags |= containsExtrasFlag;
             m_stream->readNextPosition();
         }
         else if (currentEntity->type == Type::Array)
@@ -1818,11 +2246,14 @@ void Tree::initializeJson(Entity*& currentEntity, std::vector<Extra*>& extras)
                 Entity* newElement = nullptr;
                 initializeJson(newElement, extras);
                 newElement->parent = currentArray;
-                currentArray->elements.push_back(newElement);
+                currentArray->elements.add(newElement, *m_buildArena);
+                addChildFlags(*currentArray, *newElement);
 
                 extras = initializeExtras(false);
             }
             currentArray->endExtras = extras;
+            if (extras.size() > 0)
+                currentArray->flags |= containsExtrasFlag;
             m_stream->readNextPosition();
         }
         else
@@ -1831,65 +2262,185 @@ void Tree::initializeJson(Entity*& currentEntity, std::vector<Extra*>& extras)
         return;
     }
 
+    auto entityStart = m_stream->getReader().getAddress();
     switch (getTypeFromChar(m_stream->getCurrentChar()))
     {
         case json::Type::Object:
-            currentEntity = new Object();
+        {
+            currentEntity = m_buildArena->create<Object>();
             currentEntity->extras = extras;
 
-            currentEntity->toObject().scopeFormat = m_stream->getScopeFormat(true);
-
-            m_stream->readNextPosition();
-            initializeJson(currentEntity, initializeExtras(false));
+            auto scopeStart = m_stream->getReader().getAddress();
+            bool hasChildren;
+            if (m_isLazy && !m_isReadingLazyBase)
+            {
+                hasChildren = initializeStub(*currentEntity);
+            }
+            else
+            {
+                m_isReadingLazyBase = false; //its children are stubs
+                m_stream->readNextPosition();
+                initializeJson(currentEntity, initializeExtras(false));
+                hasChildren = currentEntity->toObject().properties.size() > 0;
+            }
+            currentEntity->toObject().scopeFormat = getClosedScopeFormat(scopeStart, hasChildren);
             break;
+        }
         case json::Type::Array:
-            currentEntity = new Array();
+        {
+            currentEntity = m_buildArena->create<Array>();
             currentEntity->extras = extras;
 
-            currentEntity->toArray().scopeFormat = m_stream->getScopeFormat(true);
-
-            m_stream->readNextPosition();
-            initializeJson(currentEntity, initializeExtras(false));
+            auto scopeStart = m_stream->getReader().getAddress();
+            bool hasChildren;
+            if (m_isLazy && !m_isReadingLazyBase)
+            {
+                hasChildren = initializeStub(*currentEntity);
+            }
+            else
+            {
+                m_isReadingLazyBase = false; //its children are stubs
+                m_stream->readNextPosition();
+                initializeJson(currentEntity, initializeExtras(false));
+                hasChildren = currentEntity->toArray().elements.size() > 0;
+            }
+            currentEntity->toArray().scopeFormat = getClosedScopeFormat(scopeStart, hasChildren);
             break;
+        }
         case json::Type::String:
-            currentEntity = new JsonString(m_stream->getString());
+        {
+            //the string stays in the source text, it's only a slice
+            auto stringStart = m_stream->getReader().getAddress() + 1;
+            m_stream->skipString(false);
+            auto numBytes = (size_t)(m_stream->getReader().getAddress() - stringStart);
+            bool hasEscapes = memchr(stringStart, '\\', numBytes) != nullptr;
+            currentEntity = m_buildArena->create<JsonString>(stringStart, (juce::uint32)numBytes, hasEscapes);
             currentEntity->extras = extras;
 
             m_stream->readNextPosition();
             break;
+        }
         case json::Type::Number:
-            currentEntity = new JsonNumber(m_stream->getNumber());
+        {
+            auto numberStart = m_stream->getReader().getAddress();
+            m_stream->skipNumber(true);
+            currentEntity = createNumber(numberStart, (size_t)(m_stream->getReader().getAddress() - numberStart), false);
             currentEntity->extras = extras;
             break;
+        }
         case json::Type::Bool:
-            currentEntity = new JsonBool(m_stream->getBool());
+            currentEntity = m_buildArena->create<JsonBool>(m_stream->getBool());
             currentEntity->extras = extras;
 
             m_stream->skipBool(true);
             break;
         case json::Type::Null:
-            currentEntity = new Entity(Type::Null);
+            currentEntity = m_buildArena->create<Entity>(Type::Null);
             currentEntity->extras = extras;
 
             m_stream->skipNull(true);
             break;
-        default: jassertfalse; break;
+        default: jassertfalse; return;
     }
+    setSourceRange(*currentEntity, entityStart);
 }
 
-void Tree::initializeJsonProperty(Property*& currentProperty, std::vector<Extra*>& extras)
+void Tree::initializeJsonProperty(Property*& currentProperty, Extras extras)
 {
-    currentProperty = new Property(m_stream->getString()); //get key
+    //the key is interned straight from the text, so repeated keys don't allocate
+    auto keyStart = m_stream->getReader().getAddress() + 1;
+    m_stream->skipString(false);
+    auto keyId = m_keys.intern(keyStart, (size_t)(m_stream->getReader().getAddress() - keyStart));
+    currentProperty = m_buildArena->create<Property>(m_keys.getKey(keyId), keyId);
+    if (m_isChunk)
+        m_chunkProperties.push_back(currentProperty);
 
     currentProperty->extras = extras;
-    m_stream->readPositionAfterChar(':');
+    //comments between the key and ':' are skipped (a ':' in them isn't the key's)
+    m_stream->readNextPosition();
+    m_stream->skipCommentsAndWhitespaces();
+    m_stream->readNextPosition(); //after ':'
     initializeJson(currentProperty->value, initializeExtras(false));
     currentProperty->value->parent = currentProperty;
+    setSourceRange(*currentProperty, keyStart - 1);
+}
+
+bool Tree::initializeStub(Entity& scope)
+{
+    auto stubReadPosition = m_stream->getReadPosition();
+    if (scope.type == Type::Object)
+        scope.toObject().stubReadPosition = stubReadPosition;
+    else
+        scope.toArray().stubReadPosition = stubReadPosition;
+    scope.flags |= stubFlag;
+
+    //only peeks past the opening char's whitespaces and comments, the children aren't read
+    char closeChar = scope.type == Type::Object ? '}' : ']';
+    m_stream->readNextPosition();
+    m_stream->skipCommentsAndWhitespaces();
+    bool hasChildren = !m_stream->isAtChar(closeChar);
+    m_stream->goToPosition(stubReadPosition);
+    m_stream->skipScope(true);
+    return hasChildren;
+}
+
+void Tree::setSourceRange(Entity& entity, const char* sourceStart) const
+{
+    auto sourceText = m_sourceText.toRawUTF8();
+    entity.sourceStart = (juce::uint32)(sourceStart - sourceText);
+    entity.sourceEnd = (juce::uint32)(m_stream->getReader().getAddress() - sourceText);
+}
+
+ScopeFormat Tree::getClosedScopeFormat(const char* scopeStart, bool hasChildren)
+{
+    //only the text after the last scan is searched (backwards, so it stops at the last newline),
+    //which keeps the whole initialize() linear no matter how deep the scopes are nested
+    auto scanEnd = m_stream->getReader().getAddress();
+    for (auto reader = scanEnd; reader != m_newLineScanPosition; )
+    {
+        if (*--reader == '\n')
+        {
+            m_lastNewLine = reader;
+            break;
+        }
+    }
+    m_newLineScanPosition = scanEnd;
+
+    if (!hasChildren)
+        return ScopeFormat::Empty;
+    return m_lastNewLine > scopeStart ? ScopeFormat::Expanded : ScopeFormat::Collapsed;
+}
+
+void Tree::addChildFlags(Object& scope, const Property& child)
+{
+    const Entity* value = child.value;
+    if (child.extras.size() > 0 || value->extras.size() > 0 || (value->flags & containsExtrasFlag))
+        scope.flags |= containsExtrasFlag;
+
+    if (value->type == Type::Object)
+    {
+        scope.flags |= hasObjectPropertyFlag;
+    }
+    else if (value->type == Type::Array)
+    {
+        auto& elements = value->toArray().elements;
+        if (elements.size() > 1 || (elements.size() == 1 && isScopeType(elements[0]->type)))
+            scope.flags |= hasBigArrayPropertyFlag;
+    }
+}
+
+void Tree::addChildFlags(Array& scope, const Entity& child)
+{
+    if (child.extras.size() > 0 || (child.flags & containsExtrasFlag))
+        scope.flags |= containsExtrasFlag;
+
+    if (child.type == Type::Object || (child.type == Type::Array && (child.flags & containsNestedObjectsFlag)))
+        scope.flags |= containsNestedObjectsFlag;
 }
 
-std::vector<json::Tree::Extra*> Tree::initializeExtras(bool newLine)
+Tree::Extras Tree::initializeExtras(bool newLine)
 {
-    std::vector<Extra*> output;
+    Extras output;
     int emtpyLineCount = 0;
     while (!m_stream->isEndOfJson())
     {
@@ -1897,19 +2448,19 @@ std::vector<json::Tree::Extra*> Tree::initializeExtras(bool newLine)
         {
             if (emtpyLineCount > 0)
             {
-                output.push_back(new EmptyLine(emtpyLineCount));
+                output.add(m_buildArena->create<EmptyLine>(emtpyLineCount), *m_buildArena);
                 emtpyLineCount = 0;
             }
 
             if (m_stream->isAtSingleLineComent())
             {
-                output.push_back(new SingleLineComment(m_stream->getComment(), newLine));
-                newLine = false;
+                output.add(m_buildArena->create<SingleLineComment>(m_stream->getComment(), newLine), *m_buildArena);
+                newLine = true; //the comment's line feed was read
                 continue;
             }
             else if (m_stream->isAtMultiLineComent())
             {
-                output.push_back(new MultiLineComment(m_stream->getComment(), newLine));
+                output.add(m_buildArena->create<MultiLineComment>(m_stream->getComment(), newLine), *m_buildArena);
                 newLine = false;
                 continue;
             }
@@ -1922,7 +2473,7 @@ std::vector<json::Tree::Extra*> Tree::initializeExtras(bool newLine)
         else if (!m_stream->isAtWhitespace())
         {
             if (emtpyLineCount > 0)
-                output.push_back(new EmptyLine(emtpyLineCount));
+                output.add(m_buildArena->create<EmptyLine>(emtpyLineCount), *m_buildArena);
             break;
         }
         else if (m_stream->isAtChar('\n'))
@@ -1936,108 +2487,1673 @@ std::vector<json::Tree::Extra*> Tree::initializeExtras(bool newLine)
     return output;
 }
 
-vArray<Tree::Property*> Tree::findStringProperties(const juce::String& key, const juce::String& value)
+juce::String Tree::getText(juce::ThreadPool* threadPool)
 {
-    vArray<Tree::Property*> output;
-    findStringProperties(key, value, getBase(), output);
-    return output;
+    if (!isValid())
+        return juce::String();
+
+    juce::MemoryOutputStream output(m_sourceBytes * 2);
+    writeText(output, threadPool);
+    return output.toUTF8();
 }
 
-void Tree::findStringProperties(const juce::String& key, const juce::String& value, Entity& currentEntity, vArray<Tree::Property*>& output)
+void Tree::writeText(juce::OutputStream& output, juce::ThreadPool* threadPool)
 {
-    if (currentEntity.type == Type::Object)
-    {
-        for (auto& p : currentEntity.toObject().properties)
-        {
-            findStringProperties(key, value, *p, output);
-        }
-    }
-    else if (currentEntity.type == Type::Property)
-    {
-        auto jsonProperty = &currentEntity.toProperty();
-        if (jsonProperty->key == key && jsonProperty->value->type == Type::String && jsonProperty->value->toJsonString().data == value)
-        {
-            output.add(jsonProperty);
-        }
-        findStringProperties(key, value, *jsonProperty->value, output);
-    }
-    else if (currentEntity.type == Type::Array)
-    {
-        for (auto& e : currentEntity.toArray().elements)
-        {
-            findStringProperties(key, value, *e, output);
-        }
-    }
+    if (!isValid())
+        return;
+
+    loadAll();
+    prepareFormatRules();
+    if (threadPool == nullptr || !writeTextParallel(output, *threadPool))
+        createFormat(m_base, output, 0, m_activeFormatRules->getStartState());
+    m_activeFormatRules = nullptr;
 }
 
-void Tree::createFormat(const Entity* currentEntity, juce::String& output, int currentIndent, bool indentBeforeEntity)
+bool Tree::writeTextParallel(juce::OutputStream& output, juce::ThreadPool& threadPool)
 {
-    createExtras(currentEntity->extras, output, currentIndent);
-    if (indentBeforeEntity)
-        output += getIndentString(currentIndent);
+    if (threadPool.getNumThreads() < 2 || m_sourceBytes < (size_t)parallelMinBytes || !isScopeType(m_base->type))
+        return false;
 
-    if (currentEntity->type == Type::Object)
-    {
-        Object& currentObject = *((Object*)currentEntity);
+    bool isObject = m_base->type == Type::Object;
+    auto numChildren = isObject ? m_base->toObject().properties.size() : m_base->toArray().elements.size();
+    if (numChildren < 2)
+        return false;
 
-        if (currentObject.properties.size() == 0) //empty object
-        {
-            createObject(currentObject, output, currentIndent, ScopeFormat::Empty);
-            return;
-        }
-        if (currentEntity == m_base)
+    //the base scope is always expanded, so each child is on its own line at indent 1
+    auto ruleState = m_activeFormatRules->getStartState();
+    auto childState = isObject ? ruleState : m_activeFormatRules->enterElement(ruleState);
+    auto numJobs = (int)juce::jmin(numChildren, (size_t)threadPool.getNumThreads() * 4);
+    std::vector<std::unique_ptr<juce::MemoryOutputStream>> buffers((size_t)numJobs);
+    runParallel(threadPool, numJobs, [&](int i)
+    {
+        auto firstChild = numChildren * (size_t)i / (size_t)numJobs;
+        auto endChild = numChildren * (size_t)(i + 1) / (size_t)numJobs;
+        buffers[(size_t)i] = std::make_unique<juce::MemoryOutputStream>(m_sourceBytes * 2 / (size_t)numJobs);
+        auto& buffer = *buffers[(size_t)i];
+        for (auto c = firstChild; c < endChild; c++)
         {
-            createObject(currentObject, output, currentIndent, ScopeFormat::Expanded);
-            return;
+            Entity* child = isObject ? (Entity*)m_base->toObject().properties[c] : m_base->toArray().elements[c];
+            createFormat(child, buffer, 1, childState, true);
+            if (c < numChildren - 1)
+            {
+                buffer.writeByte(',');
+                writeLineFeed(buffer);
+            }
         }
+    });
+
+    createExtras(m_base->extras, output, 0);
+    output.writeByte(isObject ? '{' : '[');
+    writeLineFeed(output);
+    for (auto& buffer : buffers)
+        output.write(buffer->getData(), buffer->getDataSize());
+    writeLineFeed(output);
+    createExtras(isObject ? m_base->toObject().endExtras : m_base->toArray().endExtras, output, 1);
+    writeIndent(output, 0);
+    output.writeByte(isObject ? '}' : ']');
+    return true;
+}
 
-        ScopeFormat newScopeFormat = ScopeFormat::Expanded;
+void Tree::prepareFormatRules()
+{
+    m_activeFormatRules = m_formatRules != nullptr ? m_formatRules : &FormatRules::getDefault();
+    //the rules look keys up by text, do it once per key instead of once per property
+    m_formatRuleKeyIds.resize(m_keys.size());
+    for (KeyID keyId = 0; keyId < (KeyID)m_keys.size(); keyId++)
+        m_formatRuleKeyIds[keyId] = m_activeFormatRules->getKeyId(m_keys.getKey(keyId));
+}
 
-        //auto:
-        bool hasPropertyObjects = checkIfAnyPropertyMeetsCondition(currentObject, [=](Property* p)
+bool Tree::writeToFile(const juce::File& file, juce::ThreadPool* threadPool)
+{
+    if (!isValid())
+        return false;
+
+    //written to a temporary file first, so a failed write never leaves a damaged document behind
+    juce::TemporaryFile temporaryFile(file);
+    {
+        juce::FileOutputStream output(temporaryFile.getFile());
+        if (!output.openedOk())
+            return false;
+
+        writeText(output, threadPool);
+        output.flush();
+        if (output.getStatus().failed())
+            return false;
+    }
+    return temporaryFile.overwriteTargetFileWithTemporary();
+}
+
+//==============================================================================
+
+vArray<Tree::SourceEdit> Tree::getSourceEdits()
+{
+    vArray<SourceEdit> output;
+    if (!isValid() || m_sourceText.isEmpty() || !m_base->hasSourceRange())
+        return output;
+
+    loadAll();
+    prepareFormatRules();
+    getSourceEdits(*m_base, m_activeFormatRules->getStartState(), output);
+    m_activeFormatRules = nullptr;
+    return output;
+}
+
+void Tree::getSourceEdits(const Entity& entity, const FormatRuleState& ruleState, vArray<SourceEdit>& output)
+{
+    if ((entity.flags & containsModifiedFlag) == 0)
+        return;
+
+    if ((entity.flags & modifiedFlag) != 0)
+    {
+        juce::MemoryOutputStream newText;
+        writeValue(entity, newText);
+        output.add({ entity.sourceStart, entity.sourceEnd, newText.toUTF8() });
+        return;
+    }
+
+    if (entity.type == Type::Property)
+    {
+        auto& property = entity.toProperty();
+        getSourceEdits(*property.value, m_activeFormatRules->enterProperty(ruleState, m_formatRuleKeyIds[property.keyId]), output);
+    }
+    else if (entity.type == Type::Array)
+    {
+        auto elementState = m_activeFormatRules->enterElement(ruleState);
+        for (auto e : entity.toArray().elements)
+            getSourceEdits(*e, elementState, output);
+    }
+    else if (entity.type == Type::Object)
+    {
+        //added properties are after the ones from the source text
+        auto& object = entity.toObject();
+        const Property* lastSourceProperty = nullptr;
+        for (auto p : object.properties)
+        {
+            if (!p->hasSourceRange())
+            {
+                output.add(getAddedPropertiesEdit(object, lastSourceProperty, ruleState));
+                break;
+            }
+            getSourceEdits(*p, ruleState, output);
+            lastSourceProperty = p;
+        }
+    }
+}
+
+Tree::SourceEdit Tree::getAddedPropertiesEdit(const Object& object, const Property* lastSourceProperty, const FormatRuleState& ruleState)
+{
+    juce::MemoryOutputStream newText;
+    //keeps the object's format, empty objects with extras inside are expanded
+    bool isCollapsed = object.scopeFormat != ScopeFormat::Expanded && object.endExtras.size() == 0;
+    //same indent as the object's other properties
+    int indent;
+    if (lastSourceProperty != nullptr)
+        indent = getSourceIndent(lastSourceProperty->sourceStart);
+    else
+        indent = getSourceIndent(object.sourceStart) + (isCollapsed ? 0 : 1);
+
+    bool isFirst = lastSourceProperty == nullptr;
+    for (auto p : object.properties)
+    {
+        if (p->hasSourceRange())
+            continue;
+
+        if (isCollapsed)
+        {
+            if (!isFirst)
+                newText.write(", ", 2);
+            createFormat(p, newText, indent, ruleState);
+        }
+        else
+        {
+            if (!isFirst)
+                newText.writeByte(',');
+            writeLineFeed(newText);
+            createFormat(p, newText, indent, ruleState, true);
+        }
+        isFirst = false;
+    }
+
+    if (lastSourceProperty != nullptr)
+        return { lastSourceProperty->sourceEnd, lastSourceProperty->sourceEnd, newText.toUTF8() };
+
+    //the object had no properties, they go right after '{'
+    if (object.endExtras.size() > 0)
+        return { object.sourceStart + 1, object.sourceStart + 1, newText.toUTF8() };
+
+    //replaces the rest of the empty scope, e.g. "{}" or "{ }"
+    if (!isCollapsed)
+    {
+        writeLineFeed(newText);
+        writeIndent(newText, indent - 1);
+    }
+    newText.writeByte('}');
+    return { object.sourceStart + 1, object.sourceEnd, newText.toUTF8() };
+}
+
+int Tree::getSourceIndent(juce::uint32 sourceOffset) const
+{
+    auto sourceText = m_sourceText.toRawUTF8();
+    auto lineStart = sourceText + sourceOffset;
+    while (lineStart != sourceText && lineStart[-1] != '\n')
+        lineStart--;
+
+    int indent = 0;
+    while (lineStart[indent] == '\t')
+        indent++;
+    return indent;
+}
+
+void Tree::writeSplicedText(juce::OutputStream& output)
+{
+    if (!isValid())
+        return;
+    if (m_sourceText.isEmpty() || !m_base->hasSourceRange())
+    {
+        writeText(output);
+        return;
+    }
+
+    auto sourceText = m_sourceText.toRawUTF8();
+    juce::uint32 copyStart = 0;
+    for (auto& edit : getSourceEdits())
+    {
+        output.write(sourceText + copyStart, edit.start - copyStart);
+        output.write(edit.newText.toRawUTF8(), edit.newText.getNumBytesAsUTF8());
+        copyStart = edit.end;
+    }
+    output.write(sourceText + copyStart, m_sourceBytes - copyStart);
+}
+
+juce::String Tree::getSplicedText()
+{
+    juce::MemoryOutputStream output(m_sourceBytes + 256);
+    writeSplicedText(output);
+    return output.toUTF8();
+}
+
+bool Tree::writeSplicedToFile(const juce::File& file)
+{
+    if (!isValid())
+        return false;
+
+    //same as writeToFile(), the target is only replaced once the whole text is written
+    juce::TemporaryFile temporaryFile(file);
+    {
+        juce::FileOutputStream output(temporaryFile.getFile());
+        if (!output.openedOk())
+            return false;
+
+        writeSplicedText(output);
+        output.flush();
+        if (output.getStatus().failed())
+            return false;
+    }
+    return temporaryFile.overwriteTargetFileWithTemporary();
+}
+
+//==============================================================================
+
+//strict check of new text before the tree reads it, the tree's parser expects valid json
+//(it's as lenient as the parser about commas, they're skipped like whitespaces between values)
+struct JsonChecker
+{
+    JsonChecker(const char* start, const char* end) : reader(start), end(end) {}
+
+    //exactly one value, or one "key": value property, with nothing around it
+    bool isValue(bool isProperty)
+    {
+        if (isProperty)
+        {
+            if (!readString())
+                return false;
+            skipIgnored(false);
+            if (!readChar(':'))
+                return false;
+            skipIgnored(false);
+        }
+        return readValue(0) && reader == end;
+    }
+    //one value with whitespaces and comments around it
+    bool isDocument()
+    {
+        skipIgnored(false);
+        if (!readValue(0))
+            return false;
+        skipIgnored(false);
+        return reader == end;
+    }
+
+private:
+    static constexpr int maxDepth = 1000;
+
+    bool readValue(int depth)
+    {
+        if (reader == end || depth > maxDepth)
+            return false;
+
+        switch (*reader)
+        {
+            case '{':  return readScope('}', true, depth);
+            case '[':  return readScope(']', false, depth);
+            case '\"': return readString();
+            case 't':  return readWord("true", 4);
+            case 'f':  return readWord("false", 5);
+            case 'n':  return readWord("null", 4);
+            default:   return readNumber();
+        }
+    }
+    bool readScope(char closeChar, bool isObject, int depth)
+    {
+        reader++; //after '{' or '['
+        skipIgnored(true);
+        while (reader != end && *reader != closeChar)
+        {
+            if (isObject)
+            {
+                if (!readString())
+                    return false;
+                skipIgnored(false);
+                if (!readChar(':'))
+                    return false;
+                skipIgnored(false);
+            }
+            if (!readValue(depth + 1))
+                return false;
+            skipIgnored(true);
+        }
+        return readChar(closeChar);
+    }
+    bool readString()
+    {
+        if (reader == end || *reader != '\"')
+            return false;
+        for (reader++; reader < end; reader++)
+        {
+            if (*reader == '\\') //escape sequence
+                reader++;
+            else if (*reader == '\"')
+            {
+                reader++;
+                return true;
+            }
+        }
+        reader = end;
+        return false;
+    }
+    //same chars as Stream::skipNumber()
+    bool readNumber()
+    {
+        if (reader == end || !(*reader == '-' || (*reader >= '0' && *reader <= '9')))
+            return false;
+        bool hasDigit = *reader != '-';
+        for (reader++; reader != end && ((*reader >= '0' && *reader <= '9') || *reader == '.'); reader++)
+            hasDigit |= *reader != '.';
+        if (reader != end && (*reader == 'e' || *reader == 'E'))
+        {
+            reader++;
+            if (reader != end && (*reader == '+' || *reader == '-'))
+                reader++;
+            if (reader == end || *reader < '0' || *reader > '9')
+                return false;
+            while (reader != end && *reader >= '0' && *reader <= '9')
+                reader++;
+        }
+        return hasDigit;
+    }
+    bool readWord(const char* word, size_t numChars)
+    {
+        if ((size_t)(end - reader) < numChars || memcmp(reader, word, numChars) != 0)
+            return false;
+        reader += numChars;
+        return true;
+    }
+    bool readChar(char expectedChar)
+    {
+        if (reader == end || *reader != expectedChar)
+            return false;
+        reader++;
+        return true;
+    }
+    //whitespaces and comments
+    void skipIgnored(bool skipCommas)
+    {
+        while (reader != end)
+        {
+            if (*reader == ' ' || *reader == '\t' || *reader == '\r' || *reader == '\n' || (skipCommas && *reader == ','))
+            {
+                reader++;
+            }
+            else if (*reader == '/' && end - reader > 1 && reader[1] == '/')
+            {
+                while (reader != end && *reader != '\n')
+                    reader++;
+            }
+            else if (*reader == '/' && end - reader > 1 && reader[1] == '*')
+            {
+                reader += 2;
+                while (end - reader > 1 && !(reader[0] == '*' && reader[1] == '/'))
+                    reader++;
+                reader = end - reader > 1 ? reader + 2 : end;
+            }
+            else
+                return;
+        }
+    }
+
+    const char* reader;
+    const char* end;
+};
+
+struct Tree::TextMove
+{
+    const char* oldText;
+    size_t oldBytes;
+    const char* newText;
+    size_t editEnd;
+    juce::int64 shift;
+
+    juce::uint32 moveOffset(juce::uint32 offset) const { return offset >= editEnd ? (juce::uint32)((juce::int64)offset + shift) : offset; }
+    //slices of the old text, other bytes (e.g. in the arena) stay
+    const char* movePointer(const char* bytes) const
+    {
+        if (bytes < oldText || bytes >= oldText + oldBytes)
+            return bytes;
+        return newText + moveOffset((juce::uint32)(bytes - oldText));
+    }
+};
+
+void Tree::startFollowingStream()
+{
+    jassert(m_stream != nullptr); //detached trees loaded from a snapshot have no stream
+    if (m_stream == nullptr || m_isFollowingStream)
+        return;
+
+    loadAll();
+    m_stream->addEditListener(this);
+    m_isFollowingStream = true;
+}
+
+void Tree::stopFollowingStream()
+{
+    if (!m_isFollowingStream)
+        return;
+
+    m_stream->removeEditListener(this);
+    m_isFollowingStream = false;
+}
+
+void Tree::jsonTextEdited(Stream& stream, size_t startByte, size_t oldEndByte, size_t newEndByte)
+{
+    jassert(&stream == m_stream);
+    m_hasFollowedEdits = true;
+    if (!m_isUpToDate || !isValid() || !m_base->hasSourceRange())
+    {
+        rebuild();
+        return;
+    }
+
+    //keeps the old slices valid until they're moved
+    auto oldText = m_sourceText;
+    auto& newText = stream.getEntireJsonText();
+    auto shift = (juce::int64)newEndByte - (juce::int64)oldEndByte;
+
+    //the smallest entity around the edit is read again, then its parents while the new text doesn't fit it
+    Entity* newEntity = nullptr;
+    for (auto target = findSourceEntity(*m_base, startByte, oldEndByte); target != nullptr; target = target->parent)
+    {
+        newEntity = retokenize(*target, newText, target->sourceStart, (size_t)((juce::int64)target->sourceEnd + shift));
+        if (newEntity != nullptr)
+        {
+            replaceEntity(*target, *newEntity);
+            break;
+        }
+    }
+    if (newEntity == nullptr)
+    {
+        m_sourceText = oldText;
+        rebuild();
+        return;
+    }
+
+    TextMove move{ oldText.toRawUTF8(), oldText.getNumBytesAsUTF8(), newText.toRawUTF8(), oldEndByte, shift };
+    moveToNewText(*m_base, *newEntity, move);
+    m_sourceText = newText;
+    m_sourceBytes = newText.getNumBytesAsUTF8();
+
+    //a scope is expanded if its text has a newline, so the parents' formats change with a newline added or removed
+    //(they contain newEntity, so they're never Empty)
+    auto hasNewLine = [](const char* text, size_t start, size_t end) { return end > start && memchr(text + start, '\n', end - start) != nullptr; };
+    if (hasNewLine(oldText.toRawUTF8(), startByte, oldEndByte) || hasNewLine(newText.toRawUTF8(), startByte, newEndByte))
+    {
+        for (auto parent = newEntity->parent; parent != nullptr; parent = parent->parent)
+        {
+            if (!isScopeType(parent->type))
+                continue;
+            auto scopeFormat = hasNewLine(newText.toRawUTF8(), parent->sourceStart, parent->sourceEnd) ? ScopeFormat::Expanded : ScopeFormat::Collapsed;
+            if (parent->type == Type::Object)
+                parent->toObject().scopeFormat = scopeFormat;
+            else
+                parent->toArray().scopeFormat = scopeFormat;
+        }
+    }
+    //chunk trees' nodes were moved too, they don't need the old text anymore
+    for (auto& chunkTree : m_chunkTrees)
+        chunkTree->m_sourceText = juce::String();
+
+    #if CHECK_TREE_UPDATES
+    jassert((m_base->flags & containsModifiedFlag) != 0 || matchesFreshTree());
+    #endif
+}
+
+static bool isSameExtras(const Tree::Extras& extras, const Tree::Extras& freshExtras)
+{
+    if (extras.size() != freshExtras.size())
+        return false;
+
+    for (size_t i = 0; i < extras.size(); i++)
+    {
+        auto e = extras[i];
+        auto fresh = freshExtras[i];
+        if (e->type != fresh->type)
+            return false;
+        switch (e->type)
+        {
+            case Tree::ExtraType::SingleLineComment:
+                if (e->toSingleLineComment()->data != fresh->toSingleLineComment()->data || e->toSingleLineComment()->onNewLine != fresh->toSingleLineComment()->onNewLine)
+                    return false;
+                break;
+            case Tree::ExtraType::MultiLineComment:
+                if (e->toMultiLineComment()->data != fresh->toMultiLineComment()->data || e->toMultiLineComment()->onNewLine != fresh->toMultiLineComment()->onNewLine)
+                    return false;
+                break;
+            case Tree::ExtraType::EmptyLine:
+                if (e->toEmptyLine()->count != fresh->toEmptyLine()->count)
+                    return false;
+                break;
+            default: break;
+        }
+    }
+    return true;
+}
+
+static ScopeFormat getScopeFormat(const Tree::Entity& scope)
+{
+    return scope.type == Type::Object ? scope.toObject().scopeFormat : scope.toArray().scopeFormat;
+}
+
+//text and freshText are the source texts of the trees, entity's source range and string slices are compared with them
+//text is nullptr for a tree without source text (e.g. loaded from a snapshot), then only the values are compared
+//containsStubs is set if entity is or contains a stub
+static bool isSameEntity(const Tree::Entity& entity, const Tree::Entity& fresh, const char* text, const char* freshText, bool& containsStubs)
+{
+    if (entity.type != fresh.type || !isSameExtras(entity.extras, fresh.extras))
+        return false;
+    if (text != nullptr && (entity.sourceStart != fresh.sourceStart || entity.sourceEnd != fresh.sourceEnd))
+        return false;
+    //a stub's children are only known once it's loaded
+    if (Tree::isStub(entity))
+    {
+        containsStubs = true;
+        return isScopeType(entity.type) && getScopeFormat(entity) == getScopeFormat(fresh);
+    }
+
+    bool childrenContainStubs = false;
+    switch (entity.type)
+    {
+        case Type::Object:
+        {
+            auto& object = entity.toObject();
+            auto& freshObject = fresh.toObject();
+            if (object.scopeFormat != freshObject.scopeFormat || object.properties.size() != freshObject.properties.size()
+                || !isSameExtras(object.endExtras, freshObject.endExtras))
+                return false;
+            for (size_t i = 0; i < object.properties.size(); i++)
+            {
+                if (!isSameEntity(*object.properties[i], *freshObject.properties[i], text, freshText, childrenContainStubs))
+                    return false;
+            }
+            break;
+        }
+        case Type::Array:
+        {
+            auto& array = entity.toArray();
+            auto& freshArray = fresh.toArray();
+            if (array.scopeFormat != freshArray.scopeFormat || array.elements.size() != freshArray.elements.size()
+                || !isSameExtras(array.endExtras, freshArray.endExtras))
+                return false;
+            for (size_t i = 0; i < array.elements.size(); i++)
+            {
+                if (!isSameEntity(*array.elements[i], *freshArray.elements[i], text, freshText, childrenContainStubs))
+                    return false;
+            }
+            break;
+        }
+        case Type::Property:
+            if (entity.toProperty().key != fresh.toProperty().key
+                || !isSameEntity(*entity.toProperty().value, *fresh.toProperty().value, text, freshText, childrenContainStubs))
+                return false;
+            break;
+        case Type::String:
+        {
+            auto& string = entity.toJsonString();
+            auto& freshString = fresh.toJsonString();
+            if (string.numBytes != freshString.numBytes || string.hasEscapes != freshString.hasEscapes
+                || memcmp(string.utf8, freshString.utf8, string.numBytes) != 0
+                || (text != nullptr && string.utf8 - text != freshString.utf8 - freshText))
+                return false;
+            break;
+        }
+        case Type::Number:
+        {
+            auto& number = entity.toJsonNumber();
+            auto& freshNumber = fresh.toJsonNumber();
+            if (number.decimalPlaces != freshNumber.decimalPlaces || number.intValue != freshNumber.intValue
+                || (number.text == nullptr) != (freshNumber.text == nullptr) || number.numTextBytes != freshNumber.numTextBytes)
+                return false;
+            if (number.text != nullptr && (memcmp(number.text, freshNumber.text, number.numTextBytes) != 0
+                || (text != nullptr && number.text - text != freshNumber.text - freshText)))
+                return false;
+            break;
+        }
+        case Type::Bool:
+            if (entity.toJsonBool().data != fresh.toJsonBool().data)
+                return false;
+            break;
+        default: break;
+    }
+
+    //the summaries above stubs only know the loaded children, they can miss flags but not have extra ones
+    constexpr uint8_t summaryFlags = Tree::containsExtrasFlag | Tree::containsNestedObjectsFlag | Tree::hasObjectPropertyFlag | Tree::hasBigArrayPropertyFlag;
+    auto flags = entity.flags & summaryFlags;
+    auto freshFlags = fresh.flags & summaryFlags;
+    if (childrenContainStubs ? (flags & ~freshFlags) != 0 : flags != freshFlags)
+        return false;
+    containsStubs |= childrenContainStubs;
+    return true;
+}
+
+bool Tree::matchesFreshTree()
+{
+    return m_sourceText.isNotEmpty() && matchesFreshTree(m_sourceText);
+}
+
+bool Tree::matchesFreshTree(const juce::String& sourceText)
+{
+    Stream freshStream(sourceText, true);
+    Tree freshTree(&freshStream);
+    if (!isValid() || !freshTree.isValid())
+        return isValid() == freshTree.isValid();
+    //source ranges and slices are only compared with the tree's own source text
+    auto text = m_sourceText.isNotEmpty() ? m_sourceText.toRawUTF8() : nullptr;
+    bool containsStubs = false;
+    return isSameEntity(*m_base, *freshTree.m_base, text, freshTree.m_sourceText.toRawUTF8(), containsStubs);
+}
+
+Tree::Entity* Tree::findSourceEntity(Entity& entity, size_t startByte, size_t endByte)
+{
+    if (!entity.hasSourceRange() || startByte < entity.sourceStart || endByte > entity.sourceEnd)
+        return nullptr;
+
+    Entity* found = nullptr;
+    if (entity.type == Type::Property)
+    {
+        found = findSourceEntity(*entity.toProperty().value, startByte, endByte);
+    }
+    else if (entity.type == Type::Object)
+    {
+        for (auto p : entity.toObject().properties)
+        {
+            if (p->hasSourceRange() && p->sourceStart > endByte)
+                break;
+            if ((found = findSourceEntity(*p, startByte, endByte)) != nullptr)
+                break;
+        }
+    }
+    else if (entity.type == Type::Array)
+    {
+        for (auto e : entity.toArray().elements)
+        {
+            if (e->hasSourceRange() && e->sourceStart > endByte)
+                break;
+            if ((found = findSourceEntity(*e, startByte, endByte)) != nullptr)
+                break;
+        }
+    }
+    return found != nullptr ? found : &entity;
+}
+
+Tree::Entity* Tree::retokenize(const Entity& oldEntity, const juce::String& newText, size_t startByte, size_t endByte)
+{
+    auto text = newText.toRawUTF8();
+    if (endByte > newText.getNumBytesAsUTF8() || !JsonChecker(text + startByte, text + endByte).isValue(oldEntity.type == Type::Property))
+        return nullptr;
+    //commas are optional, so a number right after another number's chars would be read as a part of it
+    auto isNumberChar = [](char c) { return (c >= '0' && c <= '9') || c == '.' || c == '-' || c == '+' || c == 'e' || c == 'E'; };
+    if (startByte > 0 && isNumberChar(text[startByte - 1]) && isNumberChar(text[startByte]))
+        return nullptr;
+
+    //read by the same functions as initialize(), from a stream that shares the new text
+    Stream stream(newText, true);
+    stream.goToAddress(text + startByte);
+    auto editedStream = m_stream;
+    m_stream = &stream;
+    m_sourceText = newText;
+    m_newLineScanPosition = m_lastNewLine = text + startByte;
+
+    Entity* newEntity = nullptr;
+    if (oldEntity.type == Type::Property)
+    {
+        Property* newProperty = nullptr;
+        initializeJsonProperty(newProperty, oldEntity.extras);
+        newEntity = newProperty;
+    }
+    else
+        initializeJson(newEntity, oldEntity.extras);
+
+    m_stream = editedStream;
+    //the same at the end, a number read from the range can run on into the digits after it
+    if (newEntity->sourceEnd != endByte)
+        return nullptr;
+    return newEntity;
+}
+
+void Tree::replaceEntity(Entity& oldEntity, Entity& newEntity)
+{
+    //a string value is indexed by its property
+    auto indexedEntity = oldEntity.parent != nullptr && oldEntity.parent->type == Type::Property ? oldEntity.parent : &oldEntity;
+    if (m_stringPropertyIndex != nullptr)
+        removeFromStringPropertyIndex(*indexedEntity);
+
+    auto parent = oldEntity.parent;
+    newEntity.parent = parent;
+    if (parent == nullptr)
+    {
+        m_base = &newEntity;
+    }
+    else if (parent->type == Type::Property)
+    {
+        parent->toProperty().value = &newEntity;
+    }
+    else if (parent->type == Type::Object)
+    {
+        auto& object = parent->toObject();
+        for (auto& p : object.properties)
+        {
+            if (p == &oldEntity)
+                p = &newEntity.toProperty();
+        }
+        object.index = nullptr; //rebuilt on the next lookup
+    }
+    else if (parent->type == Type::Array)
+    {
+        for (auto& e : parent->toArray().elements)
+        {
+            if (e == &oldEntity)
+                e = &newEntity;
+        }
+    }
+
+    for (auto scope = parent; scope != nullptr; scope = scope->parent)
+        updateSummaryFlags(*scope);
+    clearHashes(newEntity);
+
+    if (m_stringPropertyIndex != nullptr)
+        addToStringPropertyIndex(parent == indexedEntity ? *parent : newEntity);
+}
+
+void Tree::updateSummaryFlags(Entity& scope)
+{
+    if (scope.type == Type::Object)
+    {
+        auto& object = scope.toObject();
+        object.flags &= modifiedFlag | containsModifiedFlag;
+        for (auto p : object.properties)
+            addChildFlags(object, *p);
+        if (object.endExtras.size() > 0)
+            object.flags |= containsExtrasFlag;
+    }
+    else if (scope.type == Type::Array)
+    {
+        auto& array = scope.toArray();
+        array.flags &= modifiedFlag | containsModifiedFlag;
+        for (auto e : array.elements)
+            addChildFlags(array, *e);
+        if (array.endExtras.size() > 0)
+            array.flags |= containsExtrasFlag;
+    }
+}
+
+void Tree::moveToNewText(Entity& entity, const Entity& skipEntity, const TextMove& move)
+{
+    walk(entity, [&](Entity& e)
+    {
+        if (&e == &skipEntity)
+            return WalkResult::SkipChildren;
+
+        if (e.hasSourceRange())
+        {
+            e.sourceStart = move.moveOffset(e.sourceStart);
+            e.sourceEnd = move.moveOffset(e.sourceEnd);
+        }
+        if (e.type == Type::String)
+            e.toJsonString().utf8 = move.movePointer(e.toJsonString().utf8);
+        else if (e.type == Type::Number && e.toJsonNumber().text != nullptr)
+            e.toJsonNumber().text = move.movePointer(e.toJsonNumber().text);
+        return WalkResult::Continue;
+    });
+}
+
+void Tree::rebuild()
+{
+    auto& text = m_stream->getEntireJsonText();
+    m_isUpToDate = JsonChecker(text.toRawUTF8(), text.toRawUTF8() + text.getNumBytesAsUTF8()).isDocument();
+    if (!m_isUpToDate)
+        return;
+
+    //KeyIDs stay the same, the keys are still in the pool
+    bool hadStringPropertyIndex = m_stringPropertyIndex != nullptr;
+    m_stringPropertyIndex.reset();
+    m_chunkTrees.clear();
+    m_loadedScopes.clear();
+    m_leastRecentlyUsed.clear();
+    m_loadedBytes = 0;
+    m_base = nullptr;
+    m_arena.release();
+
+    initialize(nullptr);
+    m_isUpToDate = isValid();
+    if (hadStringPropertyIndex)
+        buildStringPropertyIndex();
+}
+
+//==============================================================================
+
+std::unique_ptr<Tree> Tree::createLazy(Stream* stream, size_t memoryBudget)
+{
+    std::unique_ptr<Tree> tree(new Tree());
+    tree->m_stream = stream;
+    tree->m_isLazy = true;
+    tree->m_memoryBudget = memoryBudget;
+
+    //the base's children are read in the one pass over the text (the scopes among them as stubs),
+    //into the base's own arena like a loaded scope's
+    auto baseArena = std::make_unique<Arena>();
+    tree->m_buildArena = baseArena.get();
+    tree->m_isReadingLazyBase = true;
+    tree->initialize(nullptr);
+    tree->m_isReadingLazyBase = false;
+    tree->m_buildArena = &tree->m_arena;
+    if (tree->isValid())
+    {
+        tree->m_lazyStream = std::make_unique<Stream>(tree->m_sourceText, true);
+        auto& loaded = tree->m_loadedScopes[tree->m_base];
+        loaded.arena = std::move(baseArena);
+        loaded.lruPosition = tree->m_leastRecentlyUsed.insert(tree->m_leastRecentlyUsed.end(), tree->m_base);
+        loaded.numBytes = loaded.arena->getBytesUsed();
+        tree->m_loadedBytes += loaded.numBytes;
+    }
+    return tree;
+}
+
+Tree::Entity& Tree::load(Entity& scope)
+{
+    if (!m_isLazy)
+        return scope;
+
+    if (!isStub(scope))
+    {
+        auto loaded = m_loadedScopes.find(&scope);
+        if (loaded != m_loadedScopes.end())
+            m_leastRecentlyUsed.splice(m_leastRecentlyUsed.end(), m_leastRecentlyUsed, loaded->second.lruPosition);
+        return scope;
+    }
+
+    //same as initializeJson() for a scope that's already created, the nodes go into the scope's own arena
+    auto scopeStart = m_sourceText.toRawUTF8() + scope.sourceStart;
+    auto& loaded = m_loadedScopes[&scope];
+    loaded.arena = std::make_unique<Arena>();
+    loaded.lruPosition = m_leastRecentlyUsed.insert(m_leastRecentlyUsed.end(), &scope);
+    //the stub was read with the scope above it, which is loaded
+    loaded.parentScope = scope.parent->type == Type::Property ? scope.parent->parent : scope.parent;
+    m_loadedScopes.find(loaded.parentScope)->second.childScopes.push_back(&scope);
+    m_buildArena = loaded.arena.get();
+    auto treeStream = m_stream;
+    m_stream = m_lazyStream.get();
+    m_stream->goToAddress(scopeStart, scope.type == Type::Object ? scope.toObject().stubReadPosition : scope.toArray().stubReadPosition);
+    m_stream->readNextPosition(); //after '{' or '['
+    m_newLineScanPosition = m_lastNewLine = scopeStart;
+
+    scope.flags &= ~stubFlag;
+    Entity* currentEntity = &scope;
+    initializeJson(currentEntity, initializeExtras(false));
+
+    m_stream = treeStream;
+    m_buildArena = &m_arena;
+    loaded.numBytes = loaded.arena->getBytesUsed();
+    m_loadedBytes += loaded.numBytes;
+
+    //the parents' summaries didn't know the stub's children, loading only adds flags so they're added up the chain
+    for (Entity* child = &scope; child->parent != nullptr; child = child->parent)
+    {
+        if (child->parent->type == Type::Property)
+        {
+            child = child->parent;
+            addChildFlags(child->parent->toObject(), child->toProperty());
+        }
+        else
+            addChildFlags(child->parent->toArray(), *child);
+    }
+
+    if (m_memoryBudget > 0)
+        applyMemoryBudget(scope);
+
+    #if CHECK_TREE_UPDATES
+    jassert((m_base->flags & containsModifiedFlag) != 0 || matchesFreshTree());
+    #endif
+    return scope;
+}
+
+void Tree::loadAll()
+{
+    if (!m_isLazy || !isValid())
+        return;
+
+    //a loaded stub's children are walked right after it's loaded
+    m_memoryBudget = 0;
+    walk(*m_base, [this](Entity& entity)
+    {
+        if (isStub(entity))
+            load(entity);
+        return WalkResult::Continue;
+    });
+    m_isLazy = false;
+}
+
+bool Tree::unload(Entity& scope)
+{
+    auto loaded = m_loadedScopes.find(&scope);
+    if (!m_isLazy || loaded == m_loadedScopes.end() || isStub(scope) || &scope == m_base || (scope.flags & (modifiedFlag | containsModifiedFlag)) != 0)
+        return false;
+
+    //the nodes of the children's arenas are found through the scope's nodes, so they're all listed before anything is deleted
+    std::vector<const Entity*> unloadedScopes{ &scope };
+    for (size_t i = 0; i < unloadedScopes.size(); i++)
+    {
+        for (auto childScope : m_loadedScopes.find(unloadedScopes[i])->second.childScopes)
+            unloadedScopes.push_back(childScope);
+    }
+    auto& siblingScopes = m_loadedScopes.find(loaded->second.parentScope)->second.childScopes;
+    siblingScopes.erase(std::find(siblingScopes.begin(), siblingScopes.end(), &scope));
+
+    if (scope.type == Type::Object)
+    {
+        auto& object = scope.toObject();
+        object.properties = ArenaArray<Property*>();
+        object.endExtras = Extras();
+        object.index = nullptr;
+    }
+    else
+    {
+        auto& array = scope.toArray();
+        array.elements = ArenaArray<Entity*>();
+        array.endExtras = Extras();
+    }
+    scope.flags = stubFlag;
+
+    for (auto s : unloadedScopes)
+    {
+        auto unloaded = m_loadedScopes.find(s);
+        m_loadedBytes -= unloaded->second.numBytes;
+        m_leastRecentlyUsed.erase(unloaded->second.lruPosition);
+        m_loadedScopes.erase(unloaded);
+    }
+
+    #if CHECK_TREE_UPDATES
+    jassert((m_base->flags & containsModifiedFlag) != 0 || matchesFreshTree());
+    #endif
+    return true;
+}
+
+void Tree::applyMemoryBudget(const Entity& usedScope)
+{
+    while (m_loadedBytes > m_memoryBudget)
+    {
+        //the least recently used scope that can be unloaded, only the base, scopes with edits and usedScope's path are skipped
+        const Entity* leastRecentlyUsed = nullptr;
+        for (auto scope : m_leastRecentlyUsed)
+        {
+            if (scope == m_base || (scope->flags & (modifiedFlag | containsModifiedFlag)) != 0)
+                continue;
+
+            bool isUsed = false;
+            for (auto e = &usedScope; e != nullptr && !isUsed; e = e->parent)
+                isUsed = e == scope;
+            if (!isUsed)
+            {
+                leastRecentlyUsed = scope;
+                break;
+            }
+        }
+        if (leastRecentlyUsed == nullptr || !unload(const_cast<Entity&>(*leastRecentlyUsed)))
+            return;
+    }
+}
+
+//@return the code point of the 4 hex digits, -1 if there aren't 4
+static int readHexEscape(const char* hexDigits, size_t numBytes)
+{
+    if (numBytes < 4)
+        return -1;
+
+    int codePoint = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        auto digit = juce::CharacterFunctions::getHexDigitValue((juce::juce_wchar)hexDigits[i]);
+        if (digit < 0)
+            return -1;
+        codePoint = (codePoint << 4) | digit;
+    }
+    return codePoint;
+}
+
+juce::String Tree::JsonString::getDecodedText() const
+{
+    if (!hasEscapes)
+        return getText();
+
+    juce::MemoryOutputStream output(numBytes);
+    for (juce::uint32 i = 0; i < numBytes; i++)
+    {
+        if (utf8[i] != '\\' || i + 1 == numBytes)
+        {
+            output.writeByte(utf8[i]);
+            continue;
+        }
+
+        switch (utf8[++i])
+        {
+            case 'n': output.writeByte('\n'); break;
+            case 'r': output.writeByte('\r'); break;
+            case 't': output.writeByte('\t'); break;
+            case 'f': output.writeByte('\f'); break;
+            case 'b': output.writeByte('\b'); break;
+            case 'u':
+            {
+                auto codePoint = readHexEscape(utf8 + i + 1, numBytes - i - 1);
+                if (codePoint < 0) //truncated or not hex, kept as it's written
+                {
+                    output.write(utf8 + i - 1, 2);
+                    break;
+                }
+                i += 4;
+
+                //characters outside the BMP are written as a surrogate pair of escapes
+                if (codePoint >= 0xd800 && codePoint <= 0xdbff && i + 2 < numBytes && utf8[i + 1] == '\\' && utf8[i + 2] == 'u')
+                {
+                    auto lowSurrogate = readHexEscape(utf8 + i + 3, numBytes - i - 3);
+                    if (lowSurrogate >= 0xdc00 && lowSurrogate <= 0xdfff)
+                    {
+                        codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (lowSurrogate - 0xdc00);
+                        i += 6;
+                    }
+                }
+                //a lone surrogate can't be written as UTF-8
+                if (codePoint >= 0xd800 && codePoint <= 0xdfff)
+                    codePoint = 0xfffd;
+                output << juce::String::charToString((juce::juce_wchar)codePoint);
+                break;
+            }
+            default: output.writeByte(utf8[i]); break; //'\"', '\\', '/'
+        }
+    }
+    return output.toUTF8();
+}
+
+Tree::JsonString* Tree::createString(const juce::String& text)
+{
+    return createString(text.toRawUTF8(), text.getNumBytesAsUTF8());
+}
+
+Tree::JsonString* Tree::createString(const char* utf8, size_t numBytes)
+{
+    auto bytes = copyToArena(utf8, numBytes);
+    return m_arena.create<JsonString>(bytes, (juce::uint32)numBytes, memchr(bytes, '\\', numBytes) != nullptr);
+}
+
+const char* Tree::copyToArena(const char* utf8, size_t numBytes)
+{
+    auto bytes = (char*)m_arena.allocate(juce::jmax(numBytes, (size_t)1), 1);
+    memcpy(bytes, utf8, numBytes);
+    return bytes;
+}
+
+static const double powersOf10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+
+//@return true if number.writeValueText() gives the same text back
+static bool parseNumber(Tree::JsonNumber& number, const char* text, size_t numBytes)
+{
+    //[-]digits[.digits]
+    size_t i = 0;
+    bool isNegative = numBytes > 0 && text[0] == '-';
+    if (isNegative)
+        i++;
+
+    //up to 19 significant digits fit in a uint64
+    juce::uint64 digits = 0;
+    int numSignificant = 0;
+    auto readDigits = [&]
+    {
+        auto digitsStart = i;
+        for (; i < numBytes && text[i] >= '0' && text[i] <= '9'; i++)
+        {
+            if (numSignificant == 0 && text[i] == '0')
+                continue;
+            if (++numSignificant <= 19)
+                digits = digits * 10 + (juce::uint64)(text[i] - '0');
+        }
+        return i - digitsStart;
+    };
+
+    auto numIntDigits = readDigits();
+    bool hasPoint = i < numBytes && text[i] == '.';
+    size_t numDecimals = 0;
+    if (hasPoint)
+    {
+        i++;
+        numDecimals = readDigits();
+    }
+    bool isCanonical = i == numBytes && (numIntDigits == 1 || (numIntDigits > 1 && text[isNegative ? 1 : 0] != '0'));
+
+    if (!hasPoint && i == numBytes && numIntDigits > 0 && numSignificant <= 19 && digits <= (juce::uint64)std::numeric_limits<juce::int64>::max() + (isNegative ? 1 : 0))
+    {
+        number.intValue = (juce::int64)(isNegative ? 0 - digits : digits);
+        number.decimalPlaces = -1;
+        return isCanonical && !(isNegative && digits == 0); //"-0"
+    }
+    if (hasPoint && isCanonical && numDecimals > 0 && numSignificant <= 15 && numDecimals <= 15)
+    {
+        //both are exact doubles, so the division is the closest double to the text
+        number.doubleValue = (double)digits / powersOf10[numDecimals];
+        if (isNegative)
+            number.doubleValue = -number.doubleValue;
+        number.decimalPlaces = (juce::int8)numDecimals;
+        return true;
+    }
+
+    number.doubleValue = juce::String::fromUTF8(text, (int)numBytes).getDoubleValue();
+    number.decimalPlaces = (juce::int8)juce::jmin(numDecimals, (size_t)15);
+    return false;
+}
+
+juce::String Tree::JsonNumber::getText() const
+{
+    if (text != nullptr)
+        return juce::String::fromUTF8(text, (int)numTextBytes);
+
+    char valueText[maxValueTextBytes];
+    return juce::String::fromUTF8(valueText, (int)writeValueText(valueText));
+}
+
+size_t Tree::JsonNumber::writeValueText(char* buffer) const
+{
+    int numDecimals = juce::jmax(0, (int)decimalPlaces);
+    bool isNegative;
+    juce::uint64 magnitude;
+    if (isInteger())
+    {
+        isNegative = intValue < 0;
+        magnitude = isNegative ? 0 - (juce::uint64)intValue : (juce::uint64)intValue;
+    }
+    else
+    {
+        //at most 15 significant digits, so the scaled value rounds back to the exact digits
+        isNegative = std::signbit(doubleValue);
+        magnitude = (juce::uint64)std::llround(std::abs(doubleValue) * powersOf10[numDecimals]);
+    }
+
+    //reversed, with at least one digit before the point
+    char digits[maxValueTextBytes];
+    int numDigits = 0;
+    do
+    {
+        digits[numDigits++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0 || numDigits <= numDecimals);
+
+    size_t length = 0;
+    if (isNegative)
+        buffer[length++] = '-';
+    for (int d = numDigits - 1; d >= 0; d--)
+    {
+        buffer[length++] = digits[d];
+        if (d == numDecimals && numDecimals > 0)
+            buffer[length++] = '.';
+    }
+    return length;
+}
+
+Tree::JsonNumber* Tree::createNumber(const juce::String& text)
+{
+    return createNumber(text.toRawUTF8(), text.getNumBytesAsUTF8(), true);
+}
+
+Tree::JsonNumber* Tree::createNumber(const char* text, size_t numBytes, bool copyText)
+{
+    auto number = m_buildArena->create<JsonNumber>();
+    if (parseNumber(*number, text, numBytes))
+        return number;
+
+    //keeps the text as it is
+    if (copyText)
+    {
+        auto bytes = (char*)m_buildArena->allocate(juce::jmax(numBytes, (size_t)1), 1);
+        memcpy(bytes, text, numBytes);
+        text = bytes;
+    }
+    number->text = text;
+    number->numTextBytes = (juce::uint32)numBytes;
+    return number;
+}
+
+Tree::Property* Tree::getProperty(Object& object, KeyID keyId)
+{
+    if (keyId == invalidKeyID)
+        return nullptr;
+    load(object);
+    if (object.properties.size() < propertyIndexThreshold)
+        return object.getProperty(keyId);
+
+    if (object.index == nullptr || object.index->numIndexed != object.properties.size())
+    {
+        //the old index (if any) is left in the arena
+        juce::uint32 numSlots = 32;
+        while (numSlots < object.properties.size() * 2)
+            numSlots *= 2;
+
+        //a loaded scope's index goes in its arena, so it's deleted with the properties
+        auto loaded = m_loadedScopes.find(&object);
+        auto& arena = loaded != m_loadedScopes.end() ? *loaded->second.arena : m_arena;
+        auto newIndex = arena.create<Object::PropertyIndex>();
+        newIndex->slots = (Property**)arena.allocate(numSlots * sizeof(Property*), alignof(Property*));
+        memset(newIndex->slots, 0, numSlots * sizeof(Property*));
+        newIndex->mask = numSlots - 1;
+        newIndex->numIndexed = object.properties.size();
+
+        for (auto p : object.properties)
+        {
+            auto slot = newIndex->getSlot(p->keyId);
+            while (newIndex->slots[slot] != nullptr)
+            {
+                if (newIndex->slots[slot]->keyId == p->keyId)
+                    break; //duplicate key, the first one wins like in the linear scan
+                slot = (slot + 1) & newIndex->mask;
+            }
+            if (newIndex->slots[slot] == nullptr)
+                newIndex->slots[slot] = p;
+        }
+        object.index = newIndex;
+    }
+    return object.index->find(keyId);
+}
+
+Tree::Property* Tree::getProperty(Object& object, const juce::String& key)
+{
+    //a lazy tree only knows the keys of what's loaded, so the key is looked up after the object is
+    load(object);
+    return getProperty(object, getKeyId(key));
+}
+
+Tree::Property* Tree::RecordShape::findProperty(Object& record, KeyID keyId)
+{
+    if (keyId == invalidKeyID)
+        return nullptr;
+
+    m_numMisses++;
+    m_tree.load(record);
+    for (size_t i = 0; i < record.properties.size(); i++)
+    {
+        if (record.properties[i]->keyId == keyId)
+        {
+            if (keyId >= m_predictedIndices.size())
+                m_predictedIndices.resize((size_t)keyId + 1, noPrediction);
+            m_predictedIndices[keyId] = (juce::uint32)i;
+            return record.properties[i];
+        }
+    }
+    return nullptr;
+}
+
+static bool isStringProperty(const Tree::Entity& entity, KeyID keyId, const juce::String& value)
+{
+    if (entity.type != Type::Property)
+        return false;
+    auto& jsonProperty = entity.toProperty();
+    return jsonProperty.keyId == keyId && jsonProperty.value->type == Type::String && jsonProperty.value->toJsonString().isEqual(value);
+}
+
+vArray<Tree::Property*> Tree::findStringProperties(const juce::String& key, const juce::String& value, juce::ThreadPool* threadPool)
+{
+    vArray<Tree::Property*> output;
+    loadAll();
+    auto keyId = getKeyId(key);
+    if (keyId == invalidKeyID)
+        return output;
+
+    if (m_stringPropertyIndex != nullptr)
+    {
+        if (keyId < m_stringPropertyIndex->size())
+        {
+            auto& valueMap = (*m_stringPropertyIndex)[keyId];
+            auto found = valueMap.find(value);
+            if (found != valueMap.end())
+                output = found->second;
+        }
+        return output;
+    }
+
+    if (threadPool == nullptr)
+    {
+        findStringProperties(keyId, value, getBase(), output);
+        return output;
+    }
+
+    //each job finds the properties of its run of the tree, joined in job order they're in document order
+    std::vector<vArray<Tree::Property*>> jobOutputs((size_t)getNumWalkJobs(getBase(), *threadPool));
+    walkParallel(getBase(), *threadPool, [&](Entity& entity, int jobIndex)
+    {
+        if (isStringProperty(entity, keyId, value))
+            jobOutputs[(size_t)jobIndex].add(&entity.toProperty());
+        return WalkResult::Continue;
+    });
+    for (auto& jobOutput : jobOutputs)
+    {
+        for (auto jsonProperty : jobOutput)
+            output.add(jsonProperty);
+    }
+    return output;
+}
+
+void Tree::findStringProperties(KeyID keyId, const juce::String& value, Entity& currentEntity, vArray<Tree::Property*>& output)
+{
+    walk(currentEntity, [&](Entity& entity)
+    {
+        if (isStringProperty(entity, keyId, value))
+            output.add(&entity.toProperty());
+        return WalkResult::Continue;
+    });
+}
+
+void Tree::buildStringPropertyIndex()
+{
+    if (!isValid())
+        return;
+
+    loadAll();
+    m_stringPropertyIndex = std::make_unique<StringPropertyIndex>(m_keys.size());
+    addToStringPropertyIndex(getBase());
+}
+
+void Tree::addToStringPropertyIndex(Entity& currentEntity)
+{
+    walk(currentEntity, [this](Entity& entity)
+    {
+        if (entity.type == Type::Property && entity.toProperty().value->type == Type::String)
+        {
+            auto& jsonProperty = entity.toProperty();
+            if (jsonProperty.keyId >= m_stringPropertyIndex->size())
+                m_stringPropertyIndex->resize(m_keys.size());
+            (*m_stringPropertyIndex)[jsonProperty.keyId][jsonProperty.value->toJsonString().getText()].add(&jsonProperty);
+        }
+        return WalkResult::Continue;
+    });
+}
+
+void Tree::removeFromStringPropertyIndex(Entity& currentEntity)
+{
+    walk(currentEntity, [this](Entity& entity)
+    {
+        if (entity.type == Type::Property && entity.toProperty().value->type == Type::String && entity.toProperty().keyId < m_stringPropertyIndex->size())
+        {
+            auto& jsonProperty = entity.toProperty();
+            auto& valueMap = (*m_stringPropertyIndex)[jsonProperty.keyId];
+            auto found = valueMap.find(jsonProperty.value->toJsonString().getText());
+            if (found != valueMap.end())
+            {
+                found->second.remove(&jsonProperty);
+                if (found->second.isEmpty())
+                    valueMap.erase(found);
+            }
+        }
+        return WalkResult::Continue;
+    });
+}
+
+void Tree::setStringValue(Property& property, const juce::String& newValue)
+{
+    jassert(property.value->type == Type::String);
+    auto& jsonString = property.value->toJsonString();
+
+    if (m_stringPropertyIndex != nullptr)
+    {
+        auto& valueMap = (*m_stringPropertyIndex)[property.keyId];
+        auto found = valueMap.find(jsonString.getText());
+        if (found != valueMap.end())
+        {
+            found->second.remove(&property);
+            if (found->second.isEmpty())
+                valueMap.erase(found);
+        }
+        valueMap[newValue].add(&property);
+    }
+    //the old bytes are left in the source text/arena
+    auto numBytes = newValue.getNumBytesAsUTF8();
+    jsonString.utf8 = copyToArena(newValue.toRawUTF8(), numBytes);
+    jsonString.numBytes = (juce::uint32)numBytes;
+    jsonString.hasEscapes = memchr(jsonString.utf8, '\\', numBytes) != nullptr;
+    clearHashes(jsonString);
+    setModified(jsonString, true);
+}
+
+Tree::Property* Tree::addProperty(Object& object, const juce::String& key, Entity* value)
+{
+    auto keyId = m_keys.intern(key);
+    auto newProperty = m_arena.create<Property>(m_keys.getKey(keyId), keyId, value);
+    newProperty->parent = &object;
+    value->parent = newProperty;
+    object.properties.add(newProperty, m_arena);
+
+    //adding can only set summary flags, so each parent just takes in its changed child
+    addChildFlags(object, *newProperty);
+    for (Entity* child = &object; child->parent != nullptr; )
+    {
+        auto parent = child->parent;
+        if (parent->type == Type::Property)
+        {
+            addChildFlags(parent->parent->toObject(), parent->toProperty());
+            child = parent->parent;
+        }
+        else
+        {
+            addChildFlags(parent->toArray(), *child);
+            child = parent;
+        }
+    }
+
+    if (m_stringPropertyIndex != nullptr)
+        addToStringPropertyIndex(*newProperty);
+    clearHashes(object);
+    setModified(object, false);
+    return newProperty;
+}
+
+void Tree::setModified(Entity& entity, bool isValueChanged)
+{
+    if (isValueChanged)
+        entity.flags |= modifiedFlag;
+    for (Entity* e = &entity; e != nullptr && (e->flags & containsModifiedFlag) == 0; e = e->parent)
+        e->flags |= containsModifiedFlag;
+}
+
+//==============================================================================
+
+static juce::uint64 mixHash(juce::uint64 hash)
+{
+    //splitmix64 finalizer
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+    return hash ^ (hash >> 31);
+}
+
+static juce::uint64 combineHash(juce::uint64 hash, juce::uint64 value)
+{
+    return mixHash(hash ^ (value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2)));
+}
+
+static juce::uint64 getTextHash(juce::uint64 seed, const char* utf8, size_t numBytes)
+{
+    //FNV-1a
+    auto hash = 14695981039346656037ull ^ seed;
+    for (size_t i = 0; i < numBytes; i++)
+        hash = (hash ^ (juce::uint8)utf8[i]) * 1099511628211ull;
+    return mixHash(hash);
+}
+
+static juce::uint64 getTextHash(juce::uint64 seed, const juce::String& text)
+{
+    return getTextHash(seed, text.toRawUTF8(), text.getNumBytesAsUTF8());
+}
+
+juce::uint64 Tree::getHash(Entity& entity)
+{
+    jassert(!isStub(entity)); //call Tree::loadAll() first
+    if (entity.hash != 0)
+        return entity.hash;
+
+    auto hash = (juce::uint64)entity.type;
+    switch (entity.type)
+    {
+        case Type::Object:
+            for (auto p : entity.toObject().properties)
+                hash = combineHash(hash, getHash(*p));
+            break;
+        case Type::Array:
+            for (auto e : entity.toArray().elements)
+                hash = combineHash(hash, getHash(*e));
+            break;
+        case Type::Property: hash = combineHash(getTextHash(hash, entity.toProperty().key), getHash(*entity.toProperty().value)); break;
+        case Type::String:   hash = getTextHash(hash, entity.toJsonString().utf8, entity.toJsonString().numBytes); break;
+        case Type::Number:
+        {
+            auto& number = entity.toJsonNumber();
+            if (number.text != nullptr)
+            {
+                hash = getTextHash(hash, number.text, number.numTextBytes);
+            }
+            else
+            {
+                char valueText[JsonNumber::maxValueTextBytes];
+                hash = getTextHash(hash, valueText, number.writeValueText(valueText));
+            }
+            break;
+        }
+        case Type::Bool:     hash = mixHash(hash + (entity.toJsonBool().data ? 1 : 2)); break;
+        default:             hash = mixHash(hash); break;
+    }
+
+    entity.hash = hash != 0 ? hash : 1; //0 is "not computed"
+    return entity.hash;
+}
+
+void Tree::clearHashes(Entity& entity)
+{
+    for (auto current = &entity; current != nullptr; current = current->parent)
+        current->hash = 0;
+}
+
+vArray<Tree::Difference> Tree::diff(Tree& oldTree, Tree& newTree)
+{
+    vArray<Difference> output;
+    oldTree.loadAll();
+    newTree.loadAll();
+    if (oldTree.isValid() && newTree.isValid())
+        diff(oldTree, newTree, oldTree.getBase(), newTree.getBase(), juce::String(), output);
+    return output;
+}
+
+void Tree::diff(Tree& oldTree, Tree& newTree, Entity& oldEntity, Entity& newEntity, const juce::String& path, vArray<Difference>& output)
+{
+    if (getHash(oldEntity) == getHash(newEntity))
+        return;
+
+    auto getChildPath = [&path](const juce::String& step) { return path.isEmpty() ? step : path + "/" + step; };
+    auto getIndexStep = [](size_t index) { return "[" + juce::String((juce::int64)index) + "]"; };
+
+    if (oldEntity.type != newEntity.type || !isScopeType(oldEntity.type))
+    {
+        output.add({ Difference::Kind::Changed, path, &oldEntity, &newEntity });
+    }
+    else if (oldEntity.type == Type::Object)
+    {
+        //properties are found by key through the trees' KeyPools (and their hash indexes for wide objects)
+        auto& oldObject = oldEntity.toObject();
+        auto& newObject = newEntity.toObject();
+        for (auto oldProperty : oldObject.properties)
         {
-            return p->value->type == Type::Object;
-        });
-        //a property's array value has more than one element or contains a nested scope
-        bool hasPropertyWithBigArray = checkIfAnyPropertyMeetsCondition(currentObject, [=](Property* p)
+            auto newProperty = newTree.getProperty(newObject, newTree.getKeyId(oldProperty->key));
+            if (newProperty == nullptr)
+                output.add({ Difference::Kind::Removed, getChildPath(oldProperty->key), oldProperty->value, nullptr });
+            else
+                diff(oldTree, newTree, *oldProperty->value, *newProperty->value, getChildPath(oldProperty->key), output);
+        }
+        for (auto newProperty : newObject.properties)
         {
-            if (p->value->type != Type::Array)
-                return false;
+            if (oldTree.getProperty(oldObject, oldTree.getKeyId(newProperty->key)) == nullptr)
+                output.add({ Difference::Kind::Added, getChildPath(newProperty->key), nullptr, newProperty->value });
+        }
+    }
+    else
+    {
+        auto& oldElements = oldEntity.toArray().elements;
+        auto& newElements = newEntity.toArray().elements;
+
+        //skip the equal elements at the start and end, so an insertion or removal isn't reported as changing every element after it
+        size_t start = 0;
+        while (start < oldElements.size() && start < newElements.size() && getHash(*oldElements[start]) == getHash(*newElements[start]))
+            start++;
+        size_t oldEnd = oldElements.size();
+        size_t newEnd = newElements.size();
+        while (oldEnd > start && newEnd > start && getHash(*oldElements[oldEnd - 1]) == getHash(*newElements[newEnd - 1]))
+        {
+            oldEnd--;
+            newEnd--;
+        }
 
-            auto propertyArray = (Array*)p->value;
-            if (propertyArray->elements.size() > 1)
-                return true;
+        size_t numPaired = juce::jmin(oldEnd - start, newEnd - start);
+        for (size_t i = start; i < start + numPaired; i++)
+            diff(oldTree, newTree, *oldElements[i], *newElements[i], getChildPath(getIndexStep(i)), output);
+        for (size_t i = start + numPaired; i < oldEnd; i++)
+            output.add({ Difference::Kind::Removed, getChildPath(getIndexStep(i)), oldElements[i], nullptr });
+        for (size_t i = start + numPaired; i < newEnd; i++)
+            output.add({ Difference::Kind::Added, getChildPath(getIndexStep(i)), nullptr, newElements[i] });
+    }
+}
+
+//format of a scope after its matching FormatRules rule, sourceFormat is the format it had in the source text
+static ScopeFormat applyFormatRule(ScopeFormat autoFormat, ScopeFormat sourceFormat, FormatRules::Format ruleFormat)
+{
+    switch (ruleFormat)
+    {
+        case FormatRules::Format::Collapsed: return ScopeFormat::Collapsed;
+        case FormatRules::Format::Expanded:  return ScopeFormat::Expanded;
+        case FormatRules::Format::Preserve:  return sourceFormat;
+        default:                             return autoFormat;
+    }
+}
+
+void Tree::createFormat(const Entity* currentEntity, juce::OutputStream& output, int currentIndent, const FormatRuleState& ruleState, bool indentBeforeEntity)
+{
+    createExtras(currentEntity->extras, output, currentIndent);
+    if (indentBeforeEntity)
+        writeIndent(output, currentIndent);
+
+    if (currentEntity->type == Type::Object)
+    {
+        Object& currentObject = *((Object*)currentEntity);
+
+        if (currentObject.properties.size() == 0) //empty object
+        {
+            createObject(currentObject, output, currentIndent, ScopeFormat::Empty, ruleState);
+            return;
+        }
+        if (currentEntity == m_base)
+        {
+            createObject(currentObject, output, currentIndent, ScopeFormat::Expanded, ruleState);
+            return;
+        }
+
+        ScopeFormat newScopeFormat = ScopeFormat::Expanded;
 
-            return propertyArray->elements.size() == 1 && isScopeType(propertyArray->elements[0]->type);
-        });
+        //auto:
+        bool hasPropertyObjects = (currentObject.flags & hasObjectPropertyFlag) != 0;
+        //a property's array value has more than one element or contains a nested scope
+        bool hasPropertyWithBigArray = (currentObject.flags & hasBigArrayPropertyFlag) != 0;
         if (!containsExtras(&currentObject) && currentObject.properties.size() <= 2 && !hasPropertyObjects && !hasPropertyWithBigArray)
             newScopeFormat = ScopeFormat::Collapsed;
 
         //custom:
-        if (isOwnedByProperty(&currentObject, "ActivationEventComparators") || isOwnedByProperty(&currentObject, "ActivationEventComparator"))
-            newScopeFormat = currentObject.scopeFormat; //preserve format
-        else if (currentObject.parent->type == Type::Array)
-        {
-            auto parent2 = currentObject.parent->parent;
-            bool expandObject = false;
-            bool collapseObject = parent2 && parent2->type == Type::Property
-                && (parent2->toProperty().key == "StoredVariableDescTokens"
-                    || parent2->toProperty().key == "StoredVariableDescTokens");
+        newScopeFormat = applyFormatRule(newScopeFormat, currentObject.scopeFormat,
+            m_activeFormatRules->findFormat(ruleState, Type::Object, currentObject.properties.size(), containsExtras(&currentObject)));
 
-            jassert(!(expandObject && collapseObject));
-            if (expandObject)
-                newScopeFormat = ScopeFormat::Expanded;
-            else if (collapseObject)
-                newScopeFormat = ScopeFormat::Collapsed;
-        }
-
-        createObject(currentObject, output, currentIndent, newScopeFormat);
+        createObject(currentObject, output, currentIndent, newScopeFormat, ruleState);
     }
     else if (currentEntity->type == Type::Property)
     {
         Property& currentProperty = *((Property*)currentEntity);
-        output += "\"" + currentProperty.key + "\": ";
-        createFormat(currentProperty.value, output, currentIndent);
+        output.writeByte('\"');
+        writeString(output, currentProperty.key);
+        output.write("\": ", 3);
+        createFormat(currentProperty.value, output, currentIndent, m_activeFormatRules->enterProperty(ruleState, m_formatRuleKeyIds[currentProperty.keyId]));
     }
     else if (currentEntity->type == Type::Array)
     {
@@ -2045,12 +4161,12 @@ void Tree::createFormat(const Entity* currentEntity, juce::String& output, int c
 
         if (currentArray.elements.size() == 0) //empty array
         {
-            createArray(currentArray, output, currentIndent, ScopeFormat::Empty);
+            createArray(currentArray, output, currentIndent, ScopeFormat::Empty, ruleState);
             return;
         }
         if (currentEntity == m_base)
         {
-            createArray(currentArray, output, currentIndent, ScopeFormat::Expanded);
+            createArray(currentArray, output, currentIndent, ScopeFormat::Expanded, ruleState);
             return;
         }
 
@@ -2061,104 +4177,125 @@ void Tree::createFormat(const Entity* currentEntity, juce::String& output, int c
             newScopeFormat = ScopeFormat::Collapsed;
 
         //custom:
-        bool preserveFormat = isOwnedByProperty(&currentArray, "ActivationEventComparators")
-            || isOwnedByProperty(&currentArray, "ActivationEventComparator");
-        bool semiExpandArray = currentArray.parent->type == Type::Property && currentArray.parent->toProperty().key == "FriendlyAttackTileEffects";
-        bool collapseArray = currentArray.parent->type == Type::Property && !containsExtras(&currentArray) && currentArray.elements.size() == 1
-            && (currentArray.parent->toProperty().key == "AbilitySlots"
-                || currentArray.parent->toProperty().key == "AbilityUpgradeStrength"
-                //|| (currentArray.parent->toProperty().key == "ActivationEventComparators"
-                //    && castEntity<Object>(currentArray.elements[0])->properties.size() == 1)
-                );
-
-        jassert(!(semiExpandArray && collapseArray));
-        if (preserveFormat)
-            newScopeFormat = currentArray.scopeFormat;
-        else if (semiExpandArray)
-            newScopeFormat = ScopeFormat::Expanded;
-        else if (collapseArray)
-            newScopeFormat = ScopeFormat::Collapsed;
+        newScopeFormat = applyFormatRule(newScopeFormat, currentArray.scopeFormat,
+            m_activeFormatRules->findFormat(ruleState, Type::Array, currentArray.elements.size(), containsExtras(&currentArray)));
 
-        createArray(currentArray, output, currentIndent, newScopeFormat);
+        createArray(currentArray, output, currentIndent, newScopeFormat, ruleState);
     }
     else
     {
-        switch (currentEntity->type)
+        writeValue(*currentEntity, output);
+    }
+}
+
+void Tree::writeValue(const Entity& value, juce::OutputStream& output)
+{
+    switch (value.type)
+    {
+        case Type::String:
+            output.writeByte('\"');
+            output.write(value.toJsonString().utf8, value.toJsonString().numBytes);
+            output.writeByte('\"');
+            break;
+        case Type::Number:
         {
-            case Type::String: output += "\"" + ((JsonString*)currentEntity)->data + "\""; break;
-            case Type::Number: output += ((JsonNumber*)currentEntity)->data; break;
-            case Type::Bool:   output += StringFunctions::boolToString(((JsonBool*)currentEntity)->data); break;
-            case Type::Null:   output += "null"; break;
-            default: jassertfalse; break;
+            auto number = &value.toJsonNumber();
+            if (number->text != nullptr)
+            {
+                output.write(number->text, number->numTextBytes);
+            }
+            else
+            {
+                char valueText[JsonNumber::maxValueTextBytes];
+                output.write(valueText, number->writeValueText(valueText));
+            }
+            break;
         }
+        case Type::Bool:
+            if (value.toJsonBool().data)
+                output.write("true", 4);
+            else
+                output.write("false", 5);
+            break;
+        case Type::Null:   output.write("null", 4); break;
+        default: jassertfalse; break;
     }
 }
 
-void Tree::createExtras(const std::vector<Extra*>& extras, juce::String& output, int indentCount)
+void Tree::createExtras(const Extras& extras, juce::OutputStream& output, int indentCount)
 {
     for (auto& e : extras)
     {
         if (e->type == ExtraType::SingleLineComment)
         {
-            output += getIndentString(indentCount) + "//" + e->toSingleLineComment()->data + lineFeed;
+            writeIndent(output, indentCount);
+            output.write("//", 2);
+            writeString(output, e->toSingleLineComment()->data);
+            writeLineFeed(output);
         }
         else if (e->type == ExtraType::MultiLineComment)
         {
-            output += getIndentString(indentCount) + "/*" + e->toMultiLineComment()->data + "*/" + lineFeed;
+            writeIndent(output, indentCount);
+            output.write("/*", 2);
+            writeString(output, e->toMultiLineComment()->data);
+            output.write("*/", 2);
+            writeLineFeed(output);
         }
         else if (e->type == ExtraType::EmptyLine)
         {
-            output += getIndentString(indentCount);
+            writeIndent(output, indentCount);
             for (int i = 0; i < e->toEmptyLine()->count; i++)
-                output += lineFeed;
+                writeLineFeed(output);
         }
     }
 }
 
-void Tree::createObject(const Object& currentObject, juce::String& output, int currentIndent, ScopeFormat scopeFormat)
+void Tree::createObject(const Object& currentObject, juce::OutputStream& output, int currentIndent, ScopeFormat scopeFormat, const FormatRuleState& ruleState)
 {
     switch (scopeFormat)
     {
         case ScopeFormat::Empty:
-            output += '{';
+            output.writeByte('{');
             if (currentObject.endExtras.size() > 0) //semi-expand for extras
             {
-                output += lineFeed;
+                writeLineFeed(output);
                 createExtras(currentObject.endExtras, output, ++currentIndent);
-                output += getIndentString(--currentIndent) + '}';
+                writeIndent(output, --currentIndent);
+                output.writeByte('}');
             }
             else
-                output += '}';
+                output.writeByte('}');
             break;
 
         case ScopeFormat::Collapsed:
-            output += '{';
+            output.writeByte('{');
             for (int i = 0; i < currentObject.properties.size() - 1; i++) //prevent extra comma at the end
             {
                 //dependency on array being a single-line when it doesn't contain nested objects
-                createFormat(currentObject.properties[i], output, currentIndent);
-                output += ", ";
+                createFormat(currentObject.properties[i], output, currentIndent, ruleState);
+                output.write(", ", 2);
             }
-            createFormat(currentObject.properties[currentObject.properties.size() - 1], output, currentIndent);
-            output += '}';
+            createFormat(currentObject.properties[currentObject.properties.size() - 1], output, currentIndent, ruleState);
+            output.writeByte('}');
             break;
 
         case ScopeFormat::Expanded:
-            output += "{";
-            output += lineFeed;
+            output.writeByte('{');
+            writeLineFeed(output);
             currentIndent++;
             for (int i = 0; i < currentObject.properties.size() - 1; i++) //prevent extra comma at the end
             {
-                createFormat(currentObject.properties[i], output, currentIndent, true);
-                output += ",";
-                output += lineFeed;
+                createFormat(currentObject.properties[i], output, currentIndent, ruleState, true);
+                output.writeByte(',');
+                writeLineFeed(output);
             }
-            createFormat(currentObject.properties[currentObject.properties.size() - 1], output, currentIndent, true);
+            createFormat(currentObject.properties[currentObject.properties.size() - 1], output, currentIndent, ruleState, true);
 
-            output += lineFeed;
+            writeLineFeed(output);
             createExtras(currentObject.endExtras, output, currentIndent);
 
-            output += getIndentString(--currentIndent) + '}';
+            writeIndent(output, --currentIndent);
+            output.writeByte('}');
             break;
 
         default: jassertfalse; break;
@@ -2166,49 +4303,57 @@ void Tree::createObject(const Object& currentObject, juce::String& output, int c
 }
 
 
-void Tree::createArray(const Array& currentArray, juce::String& output, int currentIndent, ScopeFormat scopeFormat)
+void Tree::createArray(const Array& currentArray, juce::OutputStream& output, int currentIndent, ScopeFormat scopeFormat, const FormatRuleState& ruleState)
 {
     switch (scopeFormat)
     {
         case ScopeFormat::Empty:
-            output += '[';
+            output.writeByte('[');
             if (currentArray.endExtras.size() > 0) //semi-expand for extras
             {
-                output += lineFeed;
+                writeLineFeed(output);
                 createExtras(currentArray.endExtras, output, ++currentIndent);
-                output += getIndentString(--currentIndent) + ']';
+                writeIndent(output, --currentIndent);
+                output.writeByte(']');
             }
             else
-                output += ']';
+                output.writeByte(']');
             break;
 
         case ScopeFormat::Collapsed:
-            output += '[';
+        {
+            auto elementState = m_activeFormatRules->enterElement(ruleState);
+            output.writeByte('[');
             for (int i = 0; i < currentArray.elements.size() - 1; i++) //prevent extra comma at the end
             {
-                createFormat(currentArray.elements[i], output, 0);
-                output += ", ";
+                createFormat(currentArray.elements[i], output, 0, elementState);
+                output.write(", ", 2);
             }
-            createFormat(currentArray.elements[currentArray.elements.size() - 1], output, 0);
-            output += ']';
+            createFormat(currentArray.elements[currentArray.elements.size() - 1], output, 0, elementState);
+            output.writeByte(']');
             break;
+        }
         case ScopeFormat::Expanded:
-            output += "[";
-            output += lineFeed;
+        {
+            auto elementState = m_activeFormatRules->enterElement(ruleState);
+            output.writeByte('[');
+            writeLineFeed(output);
             currentIndent++;
             for (int i = 0; i < currentArray.elements.size() - 1; i++) //prevent extra comma at the end
             {
-                createFormat(currentArray.elements[i], output, currentIndent, true);
-                output += ",";
-                output += lineFeed;
+                createFormat(currentArray.elements[i], output, currentIndent, elementState, true);
+                output.writeByte(',');
+                writeLineFeed(output);
             }
-            createFormat(currentArray.elements[currentArray.elements.size() - 1], output, currentIndent, true);
+            createFormat(currentArray.elements[currentArray.elements.size() - 1], output, currentIndent, elementState, true);
 
-            output += lineFeed;
+            writeLineFeed(output);
             createExtras(currentArray.endExtras, output, currentIndent);
 
-            output += getIndentString(--currentIndent) + ']';
+            writeIndent(output, --currentIndent);
+            output.writeByte(']');
             break;
+        }
 
         default: jassertfalse; break;
     }
@@ -2216,35 +4361,17 @@ void Tree::createArray(const Array& currentArray, juce::String& output, int curr
 
 bool Tree::containsComments(const Entity* entity)
 {
-    if (containsComments(entity->extras))
-        return true;
-
-    if (entity->type == Type::Array)
-    {
-        if (containsComments(entity->toArray().endExtras))
-            return true;
-
-        for (auto& e : ((Array*)entity)->elements)
-        {
-            if (containsComments(e))
-                return true;
-        }
-    }
-    else if (entity->type == Type::Object)
+    return !walk(const_cast<Entity&>(*entity), [this](Entity& e)
     {
-        if (containsComments(entity->toObject().endExtras))
-            return true;
-
-        for (auto& p : ((Object*)entity)->properties)
-        {
-            if (containsComments(p))
-                return true;
-        }
-    }
-    return false;
+        if (containsComments(e.extras)
+            || (e.type == Type::Object && containsComments(e.toObject().endExtras))
+            || (e.type == Type::Array && containsComments(e.toArray().endExtras)))
+            return WalkResult::Stop;
+        return WalkResult::Continue;
+    });
 }
 
-bool Tree::containsComments(const std::vector<Extra*>& extras)
+bool Tree::containsComments(const Extras& extras)
 {
     for (auto& e : extras)
         if (e->type == ExtraType::SingleLineComment || e->type == ExtraType::MultiLineComment)
@@ -2252,109 +4379,489 @@ bool Tree::containsComments(const std::vector<Extra*>& extras)
     return false;
 }
 
-bool Tree::containsExtras(const Object* objectEntity)
+bool Tree::containsNestedScopes(const Object& checkScope)
 {
-    if (objectEntity->endExtras.size() > 0)
-        return true;
-    for (auto& p : objectEntity->properties)
-    {
-        if (p->extras.size() > 0)
+    for (auto& property : checkScope.properties)
+        if (isScopeType(property->value->type))
             return true;
-        if (containsExtras(p->value))
+    return false;
+}
+
+bool Tree::containsNestedScopes(const Array& checkScope)
+{
+    for (auto& element : checkScope.elements)
+        if (isScopeType(element->type))
             return true;
-    }
     return false;
 }
 
-bool Tree::containsExtras(const Array* arrayEntity)
+void Tree::writeIndent(juce::OutputStream& output, int indentCount)
 {
-    if (arrayEntity->endExtras.size() > 0)
-        return true;
-    for (auto& e : arrayEntity->elements)
+    static const char tabs[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+    constexpr int maxTabs = (int)sizeof(tabs) - 1;
+    while (indentCount > 0)
     {
-        if (containsExtras(e))
-            return true;
+        int writeCount = juce::jmin(indentCount, maxTabs);
+        output.write(tabs, (size_t)writeCount);
+        indentCount -= writeCount;
     }
-    return false;
 }
-bool Tree::containsExtras(const Entity* entity)
+
+void Tree::writeString(juce::OutputStream& output, const juce::String& text)
+{
+    output.write(text.toRawUTF8(), text.getNumBytesAsUTF8());
+}
+
+//==============================================================================
+//snapshot layout (fixed size values are little-endian, counts and lengths are LEB128 varints):
+//  "JTSN", version (uint32), source size (uint64), source modification time in ms (int64), source hash (uint64)
+//  key count, then each key's length and UTF-8 bytes, in KeyID order
+//  the base entity, entities are written depth first:
+//    type, flags, extras
+//    Object: scope format, property count, each property's (extras, flags, KeyID, value), end extras
+//    Array: scope format, element count, elements, end extras
+//    String/Number: length, UTF-8 bytes
+//    Bool: 0 or 1
+//  extras: count, then each extra's type and (onNewLine, length, UTF-8 bytes) for comments or (count) for empty lines
+
+static constexpr char snapshotMagic[] = { 'J', 'T', 'S', 'N' };
+static constexpr juce::uint32 snapshotVersion = 2;
+//deeper nesting is treated as a damaged snapshot
+static constexpr int snapshotMaxDepth = 4096;
+
+static juce::uint64 getContentHash(const void* data, size_t numBytes)
+{
+    //FNV-1a
+    auto bytes = (const juce::uint8*)data;
+    juce::uint64 hash = 14695981039346656037ull;
+    for (size_t i = 0; i < numBytes; i++)
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+//hash of the text as File::loadFileAsString() reads it, without a byte order mark
+static juce::uint64 getFileHash(const juce::File& file)
 {
-    if (entity->extras.size() > 0)
-        return true;
+    juce::MemoryMappedFile mappedFile(file, juce::MemoryMappedFile::readOnly);
+    if (mappedFile.getData() == nullptr)
+        return 0;
 
-    if (entity->type == Type::Array)
+    auto data = (const juce::uint8*)mappedFile.getData();
+    auto numBytes = mappedFile.getSize();
+    if (numBytes >= 3 && data[0] == 0xef && data[1] == 0xbb && data[2] == 0xbf)
     {
-        if (entity->toArray().endExtras.size() > 0)
-            return true;
+        data += 3;
+        numBytes -= 3;
+    }
+    return getContentHash(data, numBytes);
+}
+
+static void writeVarint(juce::OutputStream& output, juce::uint64 value)
+{
+    while (value >= 0x80)
+    {
+        output.writeByte((char)((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    output.writeByte((char)value);
+}
 
-        for (auto& e : ((Array*)entity)->elements)
+static void writeSnapshotString(juce::OutputStream& output, const juce::String& text)
+{
+    auto numBytes = text.getNumBytesAsUTF8();
+    writeVarint(output, numBytes);
+    output.write(text.toRawUTF8(), numBytes);
+}
+
+//reads the mapped snapshot, any read past the end marks it as failed and returns zeros
+struct Tree::SnapshotReader
+{
+    SnapshotReader(const void* data, size_t numBytes) : position((const juce::uint8*)data), end(position + numBytes) {}
+
+    size_t getRemaining() const { return (size_t)(end - position); }
+
+    juce::uint8 readByte()
+    {
+        if (position == end)
         {
-            if (containsExtras(e))
-                return true;
+            failed = true;
+            return 0;
         }
+        return *position++;
     }
-    else if (entity->type == Type::Object)
+    juce::uint64 readVarint()
     {
-        if (entity->toObject().endExtras.size() > 0)
-            return true;
-
-        for (auto& p : ((Object*)entity)->properties)
+        juce::uint64 value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
         {
-            if (p->extras.size() > 0)
-                return true;
-            if (containsExtras(p->value))
-                return true;
+            auto byte = readByte();
+            value |= (juce::uint64)(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+                return value;
         }
+        failed = true;
+        return 0;
     }
-    return false;
+    //counts can't be bigger than the bytes left, so damaged counts can't make huge loops
+    size_t readCount()
+    {
+        auto count = readVarint();
+        if (count > getRemaining())
+        {
+            failed = true;
+            return 0;
+        }
+        return (size_t)count;
+    }
+    const char* readBytes(size_t numBytes)
+    {
+        if (numBytes > getRemaining())
+        {
+            failed = true;
+            return nullptr;
+        }
+        auto bytes = (const char*)position;
+        position += numBytes;
+        return bytes;
+    }
+    juce::String readString()
+    {
+        auto numBytes = readCount();
+        auto bytes = readBytes(numBytes);
+        return bytes != nullptr ? juce::String::fromUTF8(bytes, (int)numBytes) : juce::String();
+    }
+    juce::uint64 readUInt64()
+    {
+        auto bytes = readBytes(sizeof(juce::uint64));
+        return bytes != nullptr ? juce::ByteOrder::littleEndianInt64(bytes) : 0;
+    }
+
+    const juce::uint8* position;
+    const juce::uint8* end;
+    bool failed = false;
+};
+
+bool Tree::writeSnapshot(const juce::File& snapshotFile, const juce::File& sourceFile)
+{
+    if (!isValid() || !sourceFile.existsAsFile())
+        return false;
+    //the snapshot is stamped with sourceFile, so the tree has to hold exactly the file's json
+    if (m_hasFollowedEdits || (m_base->flags & (modifiedFlag | containsModifiedFlag)) != 0)
+        return false;
+
+    //size and time are taken before the content is compared, a later change of the file changes them
+    auto sourceBytes = sourceFile.getSize();
+    auto sourceModificationTime = sourceFile.getLastModificationTime().toMilliseconds();
+    auto sourceHash = getFileHash(sourceFile);
+    if (m_sourceText.isEmpty() || getContentHash(m_sourceText.toRawUTF8(), m_sourceText.getNumBytesAsUTF8()) != sourceHash)
+        return false;
+
+    loadAll();
+    //written to a temporary file first, so a failed write never leaves a damaged snapshot behind
+    juce::TemporaryFile temporaryFile(snapshotFile);
+    {
+        juce::FileOutputStream output(temporaryFile.getFile());
+        if (!output.openedOk())
+            return false;
+
+        output.write(snapshotMagic, sizeof(snapshotMagic));
+        output.writeInt((int)snapshotVersion);
+        output.writeInt64(sourceBytes);
+        output.writeInt64(sourceModificationTime);
+        output.writeInt64((juce::int64)sourceHash);
+
+        writeVarint(output, m_keys.size());
+        for (KeyID keyId = 0; keyId < (KeyID)m_keys.size(); keyId++)
+            writeSnapshotString(output, m_keys.getKey(keyId));
+
+        writeSnapshotEntity(output, *m_base);
+
+        output.flush();
+        if (output.getStatus().failed())
+            return false;
+    }
+    return temporaryFile.overwriteTargetFileWithTemporary();
 }
 
-bool Tree::containsNestedScopes(const Object& checkScope)
+void Tree::writeSnapshotEntity(juce::OutputStream& output, const Entity& entity) const
 {
-    for (auto& property : checkScope.properties)
-        if (isScopeType(property->value->type))
-            return true;
-    return false;
+    output.writeByte((char)entity.type);
+    output.writeByte((char)entity.flags);
+    writeVarint(output, entity.sourceStart);
+    writeVarint(output, entity.sourceEnd);
+    writeSnapshotExtras(output, entity.extras);
+
+    switch (entity.type)
+    {
+        case Type::Object:
+        {
+            auto& object = entity.toObject();
+            output.writeByte((char)object.scopeFormat);
+            writeVarint(output, object.properties.size());
+            for (auto p : object.properties)
+            {
+                writeSnapshotExtras(output, p->extras);
+                output.writeByte((char)p->flags);
+                writeVarint(output, p->sourceStart);
+                writeVarint(output, p->sourceEnd);
+                writeVarint(output, p->keyId);
+                writeSnapshotEntity(output, *p->value);
+            }
+            writeSnapshotExtras(output, object.endExtras);
+            break;
+        }
+        case Type::Array:
+        {
+            auto& array = entity.toArray();
+            output.writeByte((char)array.scopeFormat);
+            writeVarint(output, array.elements.size());
+            for (auto e : array.elements)
+                writeSnapshotEntity(output, *e);
+            writeSnapshotExtras(output, array.endExtras);
+            break;
+        }
+        case Type::String:
+            writeVarint(output, entity.toJsonString().numBytes);
+            output.write(entity.toJsonString().utf8, entity.toJsonString().numBytes);
+            break;
+        case Type::Number: writeSnapshotString(output, entity.toJsonNumber().getText()); break;
+        case Type::Bool:   output.writeByte(entity.toJsonBool().data ? 1 : 0); break;
+        case Type::Null:   break;
+        default: jassertfalse; break;
+    }
 }
 
-bool Tree::containsNestedScopes(const Array& checkScope)
+void Tree::writeSnapshotExtras(juce::OutputStream& output, const Extras& extras)
 {
-    for (auto& element : checkScope.elements)
-        if (isScopeType(element->type))
-            return true;
-    return false;
+    writeVarint(output, extras.size());
+    for (auto e : extras)
+    {
+        output.writeByte((char)e->type);
+        switch (e->type)
+        {
+            case ExtraType::SingleLineComment:
+                output.writeByte(e->toSingleLineComment()->onNewLine ? 1 : 0);
+                writeSnapshotString(output, e->toSingleLineComment()->data);
+                break;
+            case ExtraType::MultiLineComment:
+                output.writeByte(e->toMultiLineComment()->onNewLine ? 1 : 0);
+                writeSnapshotString(output, e->toMultiLineComment()->data);
+                break;
+            case ExtraType::EmptyLine: writeVarint(output, (juce::uint64)e->toEmptyLine()->count); break;
+            default: jassertfalse; break;
+        }
+    }
 }
 
-bool Tree::checkIfAnyPropertyMeetsCondition(Object& checkObject, std::function<bool(Property*)> condition)
+std::unique_ptr<Tree> Tree::loadSnapshot(const juce::File& snapshotFile, const juce::File& sourceFile, Stream* stream)
 {
-    for (auto& property : checkObject.properties)
+    juce::MemoryMappedFile mappedSnapshot(snapshotFile, juce::MemoryMappedFile::readOnly);
+    if (mappedSnapshot.getData() == nullptr)
+        return nullptr;
+
+    SnapshotReader reader(mappedSnapshot.getData(), mappedSnapshot.getSize());
+    auto magic = reader.readBytes(sizeof(snapshotMagic));
+    auto versionBytes = reader.readBytes(sizeof(juce::uint32));
+    if (magic == nullptr || memcmp(magic, snapshotMagic, sizeof(snapshotMagic)) != 0
+        || versionBytes == nullptr || juce::ByteOrder::littleEndianInt(versionBytes) != snapshotVersion)
+        return nullptr;
+
+    //size and modification time are enough when they match, the hash is only checked for files that were touched
+    auto sourceBytes = reader.readUInt64();
+    auto sourceModificationTime = (juce::int64)reader.readUInt64();
+    auto sourceHash = reader.readUInt64();
+    if (reader.failed || !sourceFile.existsAsFile() || (juce::uint64)sourceFile.getSize() != sourceBytes)
+        return nullptr;
+    //a file written again within the time's resolution (a second on some systems) keeps its time,
+    //so the time is only trusted if the snapshot was written after it
+    bool isTimeUnchanged = sourceFile.getLastModificationTime().toMilliseconds() == sourceModificationTime
+        && snapshotFile.getLastModificationTime().toMilliseconds() > sourceModificationTime;
+    if (!isTimeUnchanged && getFileHash(sourceFile) != sourceHash)
+        return nullptr;
+
+    std::unique_ptr<Tree> tree(new Tree());
+    if (stream != nullptr)
     {
-        if (condition(property))
-            return true;
+        //attached like a built tree, the stream has to hold the text the snapshot was written from
+        auto& text = stream->getEntireJsonText();
+        if (getContentHash(text.toRawUTF8(), text.getNumBytesAsUTF8()) != sourceHash)
+            return nullptr;
+        tree->m_stream = stream;
+        tree->m_sourceText = text;
+        tree->m_sourceBytes = text.getNumBytesAsUTF8();
     }
-    return false;
+    else
+        tree->m_sourceBytes = (size_t)sourceBytes;
+
+    auto numKeys = reader.readCount();
+    for (size_t i = 0; i < numKeys && !reader.failed; i++)
+    {
+        auto numBytes = reader.readCount();
+        auto bytes = reader.readBytes(numBytes);
+        if (bytes != nullptr && tree->m_keys.intern(bytes, numBytes) != (KeyID)i)
+            return nullptr; //duplicate key
+    }
+
+    tree->m_base = tree->readSnapshotEntity(reader, nullptr, 0);
+    if (reader.failed || tree->m_base == nullptr || reader.getRemaining() != 0)
+        return nullptr;
+
+    #if CHECK_TREE_UPDATES
+    jassert(tree->matchesFreshTree(sourceFile.loadFileAsString()));
+    #endif
+    return tree;
 }
 
-bool Tree::containsNestedObjects(const Array& checkScope)
+Tree::Entity* Tree::readSnapshotEntity(SnapshotReader& reader, Entity* parent, int depth)
 {
-    for (auto element : checkScope.elements)
+    if (depth > snapshotMaxDepth)
     {
-        if (element->type == Type::Object)
-            return true;
-        if (element->type == Type::Array && containsNestedObjects(*(Array*)element))
-            return true;
+        reader.failed = true;
+        return nullptr;
     }
-    return false;
+
+    auto type = (Type)reader.readByte();
+    auto flags = reader.readByte();
+    auto sourceStart = reader.readVarint();
+    auto sourceEnd = reader.readVarint();
+    auto extras = readSnapshotExtras(reader);
+    if (reader.failed || !isSnapshotSourceRange(sourceStart, sourceEnd))
+        return nullptr;
+
+    Entity* entity = nullptr;
+    switch (type)
+    {
+        case Type::Object:
+        {
+            auto object = m_arena.create<Object>();
+            object->scopeFormat = (ScopeFormat)reader.readByte();
+            auto numProperties = reader.readCount();
+            for (size_t i = 0; i < numProperties && !reader.failed; i++)
+            {
+                auto propertyExtras = readSnapshotExtras(reader);
+                auto propertyFlags = reader.readByte();
+                auto propertySourceStart = reader.readVarint();
+                auto propertySourceEnd = reader.readVarint();
+                auto keyId = reader.readVarint();
+                if (keyId >= m_keys.size() || !isSnapshotSourceRange(propertySourceStart, propertySourceEnd))
+                {
+                    reader.failed = true;
+                    break;
+                }
+
+                auto newProperty = m_arena.create<Property>(m_keys.getKey((KeyID)keyId), (KeyID)keyId);
+                newProperty->extras = propertyExtras;
+                newProperty->flags = propertyFlags;
+                setSnapshotSourceRange(*newProperty, propertySourceStart, propertySourceEnd);
+                newProperty->parent = object;
+                newProperty->value = readSnapshotEntity(reader, newProperty, depth + 1);
+                if (newProperty->value == nullptr)
+                    break;
+                object->properties.add(newProperty, m_arena);
+            }
+            object->endExtras = readSnapshotExtras(reader);
+            entity = object;
+            break;
+        }
+        case Type::Array:
+        {
+            auto array = m_arena.create<Array>();
+            array->scopeFormat = (ScopeFormat)reader.readByte();
+            auto numElements = reader.readCount();
+            for (size_t i = 0; i < numElements && !reader.failed; i++)
+            {
+                auto newElement = readSnapshotEntity(reader, array, depth + 1);
+                if (newElement == nullptr)
+                    break;
+                array->elements.add(newElement, m_arena);
+            }
+            array->endExtras = readSnapshotExtras(reader);
+            entity = array;
+            break;
+        }
+        case Type::String:
+        {
+            auto numBytes = reader.readCount();
+            auto bytes = reader.readBytes(numBytes);
+            if (bytes == nullptr)
+                return nullptr;
+            if (m_sourceText.isEmpty())
+            {
+                //copied into the arena, the mapped snapshot is closed after loading
+                entity = createString(bytes, numBytes);
+                break;
+            }
+            //a slice of the source text between the quotes, the same as a built tree's
+            if (sourceEnd - sourceStart != numBytes + 2)
+                return nullptr;
+            auto utf8 = m_sourceText.toRawUTF8() + sourceStart + 1;
+            entity = m_arena.create<JsonString>(utf8, (juce::uint32)numBytes, memchr(utf8, '\\', numBytes) != nullptr);
+            break;
+        }
+        case Type::Number:
+        {
+            auto numBytes = reader.readCount();
+            auto bytes = reader.readBytes(numBytes);
+            if (bytes == nullptr)
+                return nullptr;
+            if (m_sourceText.isEmpty())
+                entity = createNumber(bytes, numBytes, true);
+            else
+                entity = createNumber(m_sourceText.toRawUTF8() + sourceStart, (size_t)(sourceEnd - sourceStart), false);
+            break;
+        }
+        case Type::Bool:   entity = m_arena.create<JsonBool>(reader.readByte() != 0); break;
+        case Type::Null:   entity = m_arena.create<Entity>(Type::Null); break;
+        default: reader.failed = true; return nullptr;
+    }
+    if (reader.failed)
+        return nullptr;
+
+    entity->extras = extras;
+    entity->flags = flags;
+    entity->parent = parent;
+    setSnapshotSourceRange(*entity, sourceStart, sourceEnd);
+    return entity;
 }
 
-juce::String Tree::getIndentString(int indentCount)
+Tree::Extras Tree::readSnapshotExtras(SnapshotReader& reader)
 {
-    juce::String output;
-    for (int i = 0; i < indentCount; i++)
-        output += '\t';
+    Extras output;
+    auto numExtras = reader.readCount();
+    for (size_t i = 0; i < numExtras && !reader.failed; i++)
+    {
+        switch ((ExtraType)reader.readByte())
+        {
+            case ExtraType::SingleLineComment:
+            {
+                bool onNewLine = reader.readByte() != 0;
+                output.add(m_arena.create<SingleLineComment>(reader.readString(), onNewLine), m_arena);
+                break;
+            }
+            case ExtraType::MultiLineComment:
+            {
+                bool onNewLine = reader.readByte() != 0;
+                output.add(m_arena.create<MultiLineComment>(reader.readString(), onNewLine), m_arena);
+                break;
+            }
+            case ExtraType::EmptyLine: output.add(m_arena.create<EmptyLine>((int)reader.readVarint()), m_arena); break;
+            default: reader.failed = true; break;
+        }
+    }
     return output;
 }
 
+std::unique_ptr<Tree> Tree::loadSnapshotOrBuild(Stream* stream, const juce::File& sourceFile, const juce::File& snapshotFile, juce::ThreadPool* threadPool)
+{
+    if (auto tree = loadSnapshot(snapshotFile, sourceFile, stream))
+        return tree;
+
+    auto tree = std::make_unique<Tree>(stream, threadPool);
+    if (tree->isValid())
+        tree->writeSnapshot(snapshotFile, sourceFile);
+    return tree;
+}
+
 bool Tree::isOwnedByProperty(const Entity* child, juce::String propertyKey)
 {
     Entity* currentParent = child->parent;
@@ -4,6 +4,8 @@
 #include "Globals.h"
 
 #define CALCULATE_GRID_POSITIONS 0
+//asserts Tree::matchesFreshTree() after every update a tree makes to itself and after loading a snapshot (a full parse each time, for debugging)
+#define CHECK_TREE_UPDATES 0
 
 namespace json
 {
@@ -11,11 +13,57 @@ namespace json
 class Stream;
 class Property;
 class Array;
+class FormatRules;
+struct FormatRuleState;
 
 enum class Type : uint8_t { None, Object, Array, String, Number, Bool, Null, Property };
 
 enum class ScopeFormat { Empty, Collapsed, Expanded };
 
+//property key for hot paths, precompiled from a literal, e.g. static constexpr json::Key playedAtKey("played_at");
+//keys of another length are rejected with one compare, the first 8 bytes are compared as one word
+class Key
+{
+public:
+	template<size_t numChars>
+	explicit constexpr Key(const char (&keyText)[numChars])
+		: text(keyText), numBytes(numChars - 1), prefix(readPrefix(keyText, numChars - 1)), hash(getHash(keyText, numChars - 1)) {}
+
+	bool matches(const char* keyText, size_t keyBytes) const
+	{
+		if (keyBytes != numBytes)
+			return false;
+		//short keys are put together byte by byte, reading 8 bytes could go past the end of the text
+		auto word = numBytes >= 8 ? juce::ByteOrder::littleEndianInt64(keyText) : readPrefix(keyText, keyBytes);
+		return word == prefix && (numBytes <= 8 || memcmp(keyText + 8, text + 8, numBytes - 8) == 0);
+	}
+	juce::String toString() const { return juce::String::fromUTF8(text, (int)numBytes); }
+
+	const char* text;
+	size_t numBytes;
+	//first 8 bytes (fewer for short keys), little endian
+	juce::uint64 prefix;
+	//same FNV-1a as KeyPool's
+	juce::uint32 hash;
+
+	static constexpr juce::uint32 getHash(const char* utf8, size_t numBytes)
+	{
+		juce::uint32 output = 2166136261u;
+		for (size_t i = 0; i < numBytes; i++)
+			output = (output ^ (juce::uint8)utf8[i]) * 16777619u;
+		return output;
+	}
+
+private:
+	static constexpr juce::uint64 readPrefix(const char* utf8, size_t numBytes)
+	{
+		juce::uint64 output = 0;
+		for (size_t i = 0; i < numBytes && i < 8; i++)
+			output |= (juce::uint64)(juce::uint8)utf8[i] << (8 * i);
+		return output;
+	}
+};
+
 class Position
 {
 public:
@@ -37,6 +85,7 @@ public:
 
 	//==============================================================================
 	Position operator[](const juce::String& propertyKey);
+	Position operator[](const Key& propertyKey);
 	Position getProperty(const juce::String& propertyKey);
 	juce::StringArray getPropertyKeys();
 
@@ -195,7 +244,9 @@ public:
 	explicit operator bool() const { return m_start.isValid(); }
 
 	Position operator[](const juce::String& propertyKey) { return findProperty(m_start, propertyKey); }
+	Position operator[](const Key& propertyKey) { return findProperty(m_start, propertyKey); }
 	Position findProperty(const juce::String& propertyKey) { return findProperty(m_start, propertyKey); }
+	Position findProperty(const Key& propertyKey) { return findProperty(m_start, propertyKey); }
 	Property getProperty(const juce::String& propertyKey) { return getProperty(m_start, propertyKey); }
 	juce::StringArray getPropertyKeys() { return getPropertyKeys(m_start); }
 
@@ -235,6 +286,8 @@ public:
 	const juce::String& getEntireJsonText() { return m_jsonText; }
 
 	Position findProperty(Position& jsonObject, const juce::String& key);
+	//keys are read once and compared with the Key's length and first word, no char by char matching
+	Position findProperty(Position& jsonObject, const Key& key);
 	Property getProperty(Position& jsonObject, const juce::String& key);
 	juce::StringArray getPropertyKeys(Position& jsonObject);
 	juce::Array<Property> getObjectProperties();
@@ -279,6 +332,16 @@ public:
 
 	void flushJson();
 
+	//told about every change of the text made by setData(), setString() and setInt()
+	struct EditListener
+	{
+		virtual ~EditListener() = default;
+		//bytes [startByte, oldEndByte) of the old text were replaced by bytes [startByte, newEndByte) of the new text
+		virtual void jsonTextEdited(Stream& stream, size_t startByte, size_t oldEndByte, size_t newEndByte) = 0;
+	};
+	void addEditListener(EditListener* listener) { m_editListeners.addIfNotAlreadyThere(listener); }
+	void removeEditListener(EditListener* listener) { m_editListeners.removeFirstMatchingValue(listener); }
+
 	//return new index
 	int addResizeListener(Position* listener);
 	void swapResizeListener(int listenerIndex, Position* listener);
@@ -289,6 +352,9 @@ private:
 	//@param centerPosition - position of the resizing
 	//@param shiftAmount - amount of bytes shifted
 	void jsonResized(int centerPosition, int shiftAmount);
+	void notifyEdit(size_t startByte, size_t oldEndByte, size_t newEndByte);
+	//the text is written in place, so it can't share its buffer with other Strings (e.g. a Tree's source text)
+	void makeTextUnique();
 
 public:
 	//==============================================================================
@@ -303,6 +369,12 @@ public:
 
 	void goToPosition(Position& jsonType);
 	void goToPosition(int newPosition);
+	//goes to the other stream's reader position, both streams have to share the same text (e.g. a copy of getEntireJsonText())
+	void goToPosition(const Stream& otherStream);
+	//goes to a char of the text, e.g. from getReader().getAddress() (the chars before it are counted for the read position)
+	void goToAddress(const char* address);
+	//when the address' read position is already known, e.g. from an earlier getReadPosition(), nothing is counted
+	void goToAddress(const char* address, int readPosition);
 	//start of the entire text
 	void goToJsonTextStart();
 	//start object or array
@@ -380,6 +452,7 @@ private:
 	juce::File m_jsonFile;
 	juce::String m_jsonText;
 	juce::Array<Position*> m_resizeListeners{};
+	juce::Array<EditListener*> m_editListeners;
 	Position m_start;
 
 	juce::String::CharPointerType m_reader;
@@ -401,19 +474,137 @@ inline bool isScopeType(Type checkType) { return checkType == Type::Object || ch
 
 //==============================================================================
 
-class Tree
+//monotonic allocator, nothing is freed until release() (or the destructor)
+class Arena
 {
 public:
-	//==============================================================================
-	Tree(Stream* stream) : m_stream(stream)
+	Arena(size_t blockSize = 64 * 1024) : m_blockSize(blockSize) {}
+	~Arena() { release(); }
+
+	void* allocate(size_t numBytes, size_t alignment);
+
+	template<class ObjectType, class... Args>
+	ObjectType* create(Args&&... args)
 	{
-		initialize();
+		auto object = new (allocate(sizeof(ObjectType), alignof(ObjectType))) ObjectType(std::forward<Args>(args)...);
+		//only objects that own memory outside the arena (e.g. juce::String) need their destructor called
+		if constexpr (!std::is_trivially_destructible<ObjectType>::value)
+			addDestructor(object, [](void* o) { ((ObjectType*)o)->~ObjectType(); });
+		return object;
 	}
 
-	~Tree()
+	//calls the destructors of the non-trivial objects, then frees every block at once
+	void release();
+
+	size_t getBytesUsed() const { return m_bytesUsed; }
+
+private:
+	struct Destructor
 	{
-		delete m_base;
+		void (*destroy)(void*);
+		void* object;
+		Destructor* next;
+	};
+	void addDestructor(void* object, void (*destroy)(void*));
+
+	std::vector<juce::HeapBlock<char>> m_blocks;
+	char* m_blockPosition = nullptr;
+	char* m_blockEnd = nullptr;
+	//newest first, so objects are destroyed in reverse order of creation
+	Destructor* m_destructors = nullptr;
+	size_t m_blockSize;
+	size_t m_bytesUsed = 0;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Arena)
+};
+
+//growable array whose storage comes from an Arena, old storage is left in the arena when it grows
+template<class ElementType>
+class ArenaArray
+{
+public:
+	static_assert(std::is_trivially_copyable<ElementType>::value, "ArenaArray elements are moved with memcpy");
+
+	void add(const ElementType& newElement, Arena& arena)
+	{
+		if (m_size == m_capacity)
+		{
+			size_t newCapacity = m_capacity == 0 ? 4 : m_capacity * 2;
+			auto newData = (ElementType*)arena.allocate(newCapacity * sizeof(ElementType), alignof(ElementType));
+			if (m_size > 0)
+				memcpy(newData, m_data, m_size * sizeof(ElementType));
+			m_data = newData;
+			m_capacity = newCapacity;
+		}
+		m_data[m_size++] = newElement;
 	}
+	void clear() { m_size = 0; }
+
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+
+	ElementType& operator[](size_t index) const { jassert(index < m_size); return m_data[index]; }
+	ElementType& back() const { jassert(m_size > 0); return m_data[m_size - 1]; }
+	ElementType* begin() const { return m_data; }
+	ElementType* end() const { return m_data + m_size; }
+
+private:
+	ElementType* m_data = nullptr;
+	size_t m_size = 0;
+	size_t m_capacity = 0;
+};
+
+typedef juce::uint32 KeyID;
+static constexpr KeyID invalidKeyID = 0xffffffff;
+
+//stores every distinct property key once and gives it a small id, ids are given in order from 0
+class KeyPool
+{
+public:
+	KeyPool() {}
+
+	//adds the key if it isn't in the pool yet, doesn't allocate for keys that are
+	KeyID intern(const char* utf8, size_t numBytes);
+	KeyID intern(const juce::String& key) { return intern(key.toRawUTF8(), key.getNumBytesAsUTF8()); }
+	//invalidKeyID if the key isn't in the pool
+	KeyID find(const char* utf8, size_t numBytes) const;
+	KeyID find(const juce::String& key) const { return find(key.toRawUTF8(), key.getNumBytesAsUTF8()); }
+	//uses the Key's precomputed hash
+	KeyID find(const Key& key) const;
+
+	//the reference stays valid for the lifetime of the pool
+	const juce::String& getKey(KeyID keyId) const { jassert(keyId < m_keys.size()); return m_keys[keyId]; }
+	size_t size() const { return m_keys.size(); }
+
+private:
+	static juce::uint32 getHash(const char* utf8, size_t numBytes);
+	//index of the key's slot, or of the empty slot where it would go
+	size_t findSlot(const char* utf8, size_t numBytes, juce::uint32 hash) const;
+	void grow();
+
+	//deque so the references given by getKey() aren't invalidated
+	std::deque<juce::String> m_keys;
+	std::vector<juce::uint32> m_hashes;
+	//open addressing with linear probing, each slot is a KeyID + 1 (0 for an empty slot)
+	std::vector<KeyID> m_slots;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(KeyPool)
+};
+
+//==============================================================================
+
+class Tree : private Stream::EditListener
+{
+public:
+	//==============================================================================
+	//with a thread pool, big documents are split at the base scope's children, which are then built concurrently
+	Tree(Stream* stream, juce::ThreadPool* threadPool = nullptr) : m_stream(stream)
+	{
+		initialize(threadPool);
+	}
+
+	//every node is owned by m_arena, so there is nothing to delete here
+	~Tree() { stopFollowingStream(); }
 
 	//==============================================================================
 	enum class ExtraType : uint8_t { None, SingleLineComment, MultiLineComment, EmptyLine};
@@ -422,10 +613,11 @@ public:
 	struct MultiLineComment;
 	struct EmptyLine;
 
+	//nodes are allocated from the tree's Arena and are never deleted individually,
+	//so they don't have virtual destructors (or a vtable)
 	struct Extra
 	{
 		Extra(ExtraType type = ExtraType::None) : type(type) {}
-		virtual ~Extra() {};
 
 		SingleLineComment* toSingleLineComment() const { jassert(ExtraType::SingleLineComment == type); return (SingleLineComment*)this; }
 		MultiLineComment* toMultiLineComment() const { jassert(ExtraType::MultiLineComment == type); return (MultiLineComment*)this; }
@@ -436,24 +628,23 @@ public:
 	struct SingleLineComment : Extra
 	{
 		SingleLineComment(const juce::String& data = "", bool onNewLine = true) : Extra(ExtraType::SingleLineComment), data(data), onNewLine(onNewLine) {}
-		~SingleLineComment() override {}
 		juce::String data;
 		bool onNewLine; //deprecated
 	};
 	struct MultiLineComment : Extra
 	{
 		MultiLineComment(const juce::String& data = "", bool onNewLine = true) : Extra(ExtraType::MultiLineComment), data(data), onNewLine(onNewLine) {}
-		~MultiLineComment() override {}
 		juce::String data;
 		bool onNewLine; //deprecated
 	};
 	struct EmptyLine : Extra
 	{
 		EmptyLine(int count = 0) : Extra(ExtraType::EmptyLine), count(count) {}
-		~EmptyLine() override {}
 		int count;
 	};
 
+	typedef ArenaArray<Extra*> Extras;
+
 	//==============================================================================
 	struct JsonString;
 	struct JsonNumber;
@@ -462,14 +653,21 @@ public:
 	struct Object;
 	struct Array;
 
+	//summary bits of an entity and its subtree, computed once by initialize()
+	enum EntityFlags : uint8_t
+	{
+		containsExtrasFlag = 1 << 0,        //scope has extras inside it (the extras above the scope aren't counted)
+		containsNestedObjectsFlag = 1 << 1, //array has an object element, directly or inside a nested array
+		hasObjectPropertyFlag = 1 << 2,     //object has a property whose value is an object
+		hasBigArrayPropertyFlag = 1 << 3,   //object has a property whose array value has more than one element or a nested scope
+		modifiedFlag = 1 << 4,              //value was changed after initialize(), its source range holds the old value
+		containsModifiedFlag = 1 << 5,      //an entity in the subtree was changed or added after initialize()
+		stubFlag = 1 << 6                   //scope of a lazy tree whose children haven't been read, see Tree::load()
+	};
+
 	struct Entity
 	{
 		Entity(Type type = Type::None) : type(type) {}
-		virtual ~Entity() 
-		{
-			for (auto& e : extras)
-				delete e;
-		}
 
 		JsonString& toJsonString() const { jassert(getEntityTypeEnum<JsonString>() == type); return *(JsonString*)this; }
 		JsonNumber& toJsonNumber() const { jassert(getEntityTypeEnum<JsonNumber>() == type); return *(JsonNumber*)this; }
@@ -480,128 +678,531 @@ public:
 
 		//comments before/above entity
 		Entity* parent = nullptr;
-		std::vector<Extra*> extras;
+		Extras extras;
 		Type type;
-		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Entity)
+		//EntityFlags
+		uint8_t flags = 0;
+		//byte range in the tree's source text, from the first char to after the last char (extras aren't included)
+		//properties start at their key. sourceEnd is 0 for entities that weren't read from the source text
+		juce::uint32 sourceStart = 0;
+		juce::uint32 sourceEnd = 0;
+		bool hasSourceRange() const { return sourceEnd != 0; }
+		//see Tree::getHash(), 0 until it's computed
+		juce::uint64 hash = 0;
+		JUCE_DECLARE_NON_COPYABLE(Entity)
 	};
+	//the string's UTF-8 bytes as they're written in the json (escape sequences aren't applied, same as Stream::getString())
+	//the bytes are a slice of the tree's source text, or are in the tree's Arena (see Tree::createString()), they aren't null-terminated
 	struct JsonString : Entity
 	{
-		JsonString(const juce::String& data = "") : Entity(Type::String), data(data) {}
-		~JsonString() override {}
-		operator juce::String&() { return data; }
-		juce::String data;
-		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(JsonString)
+		JsonString(const char* utf8 = "", juce::uint32 numBytes = 0, bool hasEscapes = false)
+			: Entity(Type::String), utf8(utf8), numBytes(numBytes), hasEscapes(hasEscapes) {}
+		operator juce::String() const { return getText(); }
+		juce::String getText() const { return juce::String::fromUTF8(utf8, (int)numBytes); }
+		//with escape sequences applied
+		juce::String getDecodedText() const;
+		bool isEqual(const juce::String& compare) const { return compare.getNumBytesAsUTF8() == numBytes && memcmp(compare.toRawUTF8(), utf8, numBytes) == 0; }
+
+		const char* utf8;
+		juce::uint32 numBytes;
+		//if not, getDecodedText() is the same as getText()
+		bool hasEscapes;
+		JUCE_DECLARE_NON_COPYABLE(JsonString)
 	};
+	//the value is parsed once, the text is written back from it
+	//the source text is only kept (like JsonString's bytes) if writing the value wouldn't give the same text, e.g. "01", "-0" or more than 15 digits
 	struct JsonNumber : Entity
 	{
-		JsonNumber(const juce::String& data = "") : Entity(Type::Number), data(data) {}
-		~JsonNumber() override {}
-		juce::String data;
-		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(JsonNumber)
+		JsonNumber() : Entity(Type::Number) {}
+		bool isInteger() const { return decimalPlaces < 0; }
+		juce::int64 getIntValue() const { return isInteger() ? intValue : (juce::int64)doubleValue; }
+		double getDoubleValue() const { return isInteger() ? (double)intValue : doubleValue; }
+		juce::String getText() const;
+
+		static constexpr int maxValueTextBytes = 24;
+		//writes the value's text (not the kept text) into buffer, @return its byte count
+		size_t writeValueText(char* buffer) const;
+
+		union
+		{
+			juce::int64 intValue = 0;
+			double doubleValue;
+		};
+		//source text when the value doesn't write it back, otherwise nullptr
+		const char* text = nullptr;
+		juce::uint32 numTextBytes = 0;
+		//decimal places written for doubles, -1 for integers
+		juce::int8 decimalPlaces = -1;
+		JUCE_DECLARE_NON_COPYABLE(JsonNumber)
 	};
 	struct JsonBool : Entity
 	{
 		JsonBool(bool data = false) : Entity(Type::Bool), data(data) {}
-		~JsonBool() override {}
 		operator bool() { return data; }
 		bool data;
-		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(JsonBool)
+		JUCE_DECLARE_NON_COPYABLE(JsonBool)
 	};
 	struct Property : Entity
 	{
-		Property(const juce::String& key = "", Entity* value = nullptr) : Entity(Type::Property), key(key), value(value) {}
-		~Property() override
-		{
-			delete value;
-		}
-		juce::String key;
+		//pooledKey has to come from a KeyPool that lives as long as the tree (see Tree::internKey())
+		Property(const juce::String& pooledKey, KeyID keyId, Entity* value = nullptr) : Entity(Type::Property), key(pooledKey), keyId(keyId), value(value) {}
+		const juce::String& key;
+		KeyID keyId;
 		Entity* value;
-		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Property)
+		JUCE_DECLARE_NON_COPYABLE(Property)
 	};
 	struct Object : Entity
 	{
 		Object() : Entity(Type::Object) {}
-		~Object() override
+		Property* operator[](const juce::String& key) { return getProperty(key); }
+		Property* operator[](KeyID keyId) { return getProperty(keyId); }
+		Property* getProperty(const juce::String& key)
 		{
 			for (auto& p : properties)
-				delete p;
-			for (auto& e : endExtras)
-				delete e;
+			{
+				//keys are pooled, so equal keys usually share their text
+				if (p->key.getCharPointer() == key.getCharPointer() || p->key == key)
+					return p;
+			}
+			return nullptr;
 		}
-		Property* operator[](const juce::String& key) { return getProperty(key); }
-		Property* getProperty(const juce::String& key)
+		//faster than the string version, get the id with Tree::getKeyId()
+		//uses the hash index if Tree::getProperty() has built one, otherwise it's a linear scan
+		Property* getProperty(KeyID keyId)
 		{
+			if (index != nullptr && index->numIndexed == properties.size())
+				return index->find(keyId);
+
 			for (auto& p : properties)
 			{
-				if (p->key == key)
+				if (p->keyId == keyId)
 					return p;
 			}
 			return nullptr;
 		}
 
-		std::vector<Property*> properties;
+		//open-addressing index of wide objects' properties by KeyID, allocated from the tree's Arena
+		//it's rebuilt when properties are added, properties shouldn't be replaced or removed once it exists
+		struct PropertyIndex
+		{
+			Property* find(KeyID keyId) const
+			{
+				for (auto slot = getSlot(keyId);; slot = (slot + 1) & mask)
+				{
+					if (slots[slot] == nullptr || slots[slot]->keyId == keyId)
+						return slots[slot];
+				}
+			}
+			//ids are dense, so a multiplicative hash spreads them well enough
+			juce::uint32 getSlot(KeyID keyId) const { return (keyId * 2654435761u) & mask; }
+
+			Property** slots;
+			juce::uint32 mask;
+			size_t numIndexed;
+		};
+
+		ArenaArray<Property*> properties;
 		//extras after the last property
-		std::vector<Extra*> endExtras;
+		Extras endExtras;
 		ScopeFormat scopeFormat = ScopeFormat::Empty;
-		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Object)
+		//Stream read position of the '{', only set for stubs
+		int stubReadPosition = 0;
+		PropertyIndex* index = nullptr;
+		JUCE_DECLARE_NON_COPYABLE(Object)
 	};
 	struct Array : Entity
 	{
 		Array() : Entity(Type::Array) {}
-		~Array() override
-		{
-			for (auto& e : elements)
-				delete e;
-			for (auto& e : endExtras)
-				delete e;
-		}
-		std::vector<Entity*> elements;
+		ArenaArray<Entity*> elements;
 		//extras after the last element
-		std::vector<Extra*> endExtras;
+		Extras endExtras;
 		ScopeFormat scopeFormat = ScopeFormat::Empty;
-		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Array)
+		//Stream read position of the '[', only set for stubs
+		int stubReadPosition = 0;
+		JUCE_DECLARE_NON_COPYABLE(Array)
 	};
 
 	//==============================================================================
 	static bool isEqualJsonData(Stream& stream1, Stream& stream2, bool ignoreCommas = true);
+	//compares the base hashes, extras and formatting are ignored
+	static bool isEqualJsonData(Tree& tree1, Tree& tree2)
+	{
+		tree1.loadAll();
+		tree2.loadAll();
+		return tree1.isValid() && tree2.isValid() && getHash(tree1.getBase()) == getHash(tree2.getBase());
+	}
+
+	//64-bit hash of the entity's json data (keys, values and their order, not extras or formatting)
+	//computed on first use and kept in the entity, so equal subtrees are found in O(1) after that
+	//entities changed without Tree's editing functions need clearHashes() on them
+	static juce::uint64 getHash(Entity& entity);
+	//clears the cached hashes of the entity and its parents
+	static void clearHashes(Entity& entity);
+
+	struct Difference
+	{
+		enum class Kind : uint8_t { Added, Removed, Changed };
+
+		Kind kind;
+		//property keys and array indices from the base, e.g. "Items/[3]/Name" (old index for removed elements)
+		juce::String path;
+		//nullptr for Added
+		Entity* oldEntity;
+		//nullptr for Removed
+		Entity* newEntity;
+	};
+	//structural diff, only subtrees with different hashes are visited
+	//properties are matched by key, arrays by position after skipping their equal start and end elements
+	static vArray<Difference> diff(Tree& oldTree, Tree& newTree);
 
 	//==============================================================================
-	void initialize();
+	void initialize(juce::ThreadPool* threadPool = nullptr);
+
+	//smaller texts are always built and formatted on the calling thread
+	static constexpr int parallelMinBytes = 256 * 1024;
 
 private:
+	//for loadSnapshot() (which sets the stream itself when it has one) and createLazy()
+	Tree() : m_stream(nullptr) {}
+	JsonString* createString(const char* utf8, size_t numBytes);
+	//for string bytes that aren't a slice of the source text
+	const char* copyToArena(const char* utf8, size_t numBytes);
+	//copyText is for text that isn't in the source text
+	JsonNumber* createNumber(const char* text, size_t numBytes, bool copyText);
+	struct SnapshotReader;
+	void writeSnapshotEntity(juce::OutputStream& output, const Entity& entity) const;
+	static void writeSnapshotExtras(juce::OutputStream& output, const Extras& extras);
+	Entity* readSnapshotEntity(SnapshotReader& reader, Entity* parent, int depth);
+	bool isSnapshotSourceRange(juce::uint64 sourceStart, juce::uint64 sourceEnd) const { return sourceStart <= sourceEnd && sourceEnd <= m_sourceBytes; }
+	//only a tree attached to a stream keeps the source ranges, a detached tree has no text they'd point into
+	void setSnapshotSourceRange(Entity& entity, juce::uint64 sourceStart, juce::uint64 sourceEnd) const
+	{
+		if (m_sourceText.isNotEmpty())
+		{
+			entity.sourceStart = (juce::uint32)sourceStart;
+			entity.sourceEnd = (juce::uint32)sourceEnd;
+		}
+	}
+	Extras readSnapshotExtras(SnapshotReader& reader);
+	//chunk of the base scope's children, built by its own Tree on a worker thread
+	Tree(std::unique_ptr<Stream> chunkStream);
+	//@return false if the document isn't worth splitting, nothing has been read in that case
+	bool initializeParallel(juce::ThreadPool& threadPool, Extras baseExtras);
+	//reads numChildren properties/elements, and the end extras if it's the last chunk
+	void initializeChunk(bool isObject, int numChildren, bool isLastChunk, std::vector<Entity*>& children, Extras& endExtras);
+	//call at the scope's first char, skips the scope and returns whether it has children
+	bool initializeStub(Entity& scope);
+
 	//use initializeExtras() for the extras argument
-	void initializeJson(Entity*& currentEntity, std::vector<Extra*>& extras);
-	void initializeJsonProperty(Property*& currentProperty, std::vector<Extra*>& extras);
+	void initializeJson(Entity*& currentEntity, Extras extras);
+	void initializeJsonProperty(Property*& currentProperty, Extras extras);
 	//skips whitespaces afterwards
-	std::vector<Extra*> initializeExtras(bool newLine);
+	Extras initializeExtras(bool newLine);
+	//call right after the scope's closing char: Empty without children, otherwise Expanded if there's a newline anywhere in the scope
+	//(Stream::getScopeFormat() scans ahead instead, and only returns Empty if there are just spaces between the brackets)
+	ScopeFormat getClosedScopeFormat(const char* scopeStart, bool hasChildren);
+	//adds the child's summary to its scope's EntityFlags
+	static void addChildFlags(Object& scope, const Property& child);
+	static void addChildFlags(Array& scope, const Entity& child);
 
 public:
-	bool isValid() { return m_stream && m_stream->getStart().isValid(); }
+	bool isValid() { return m_base != nullptr; }
 
 	void debugFormat()
 	{
 		if (!isValid())
 			return;
-		juce::File(g_debugPath + "\\DebugJsonFormat.json").replaceWithText(getText());
+		writeToFile(juce::File(g_debugPath + "\\DebugJsonFormat.json"));
 	}
-	juce::String getText()
+	//with a thread pool, big documents have the base scope's children formatted concurrently, the text is the same
+	juce::String getText(juce::ThreadPool* threadPool = nullptr);
+	//writes the formatted json straight into the output (e.g. a FileOutputStream or MemoryOutputStream)
+	void writeText(juce::OutputStream& output, juce::ThreadPool* threadPool = nullptr);
+	//replaces the file's contents with the formatted json
+	bool writeToFile(const juce::File& file, juce::ThreadPool* threadPool = nullptr);
+
+	//==============================================================================
+	//source ranges:
+	//entities read from the source text know their byte range in it, so a changed tree can be saved by only rewriting
+	//what the editing functions changed. the rest of the source text is copied as it is, hand formatting included
+
+	struct SourceEdit
 	{
-		if (!isValid())
-			return juce::String();
-		juce::String output;
-		output.preallocateBytes(m_stream->getEntireJsonText().length() * 2);
-		createFormat(m_base, output, 0);
-		return output;
-	}
+		//byte range of the source text that's replaced, start == end for insertions
+		juce::uint32 start;
+		juce::uint32 end;
+		juce::String newText;
+	};
+	//the edits made since initialize(), in source text order (empty if nothing was changed)
+	vArray<SourceEdit> getSourceEdits();
+	//the source text with getSourceEdits() applied, same as writeText() if the tree has no source text (e.g. loaded from a snapshot)
+	void writeSplicedText(juce::OutputStream& output);
+	juce::String getSplicedText();
+	bool writeSplicedToFile(const juce::File& file);
+
+	//custom layout rules used by the formatter, nullptr for FormatRules::getDefault()
+	//the rules aren't owned and have to outlive any formatting
+	void setFormatRules(const FormatRules* rules) { m_formatRules = rules; }
+
+	//==============================================================================
+	//snapshots:
+	//a snapshot is a position-independent binary image of the tree (extras, scope formats and source ranges included),
+	//tied to the size, modification time and content hash of the file the tree was built from
+
+	//only written if the tree holds exactly sourceFile's json: it was built from the file's current text, wasn't edited
+	//and didn't follow stream edits (detached trees loaded from a snapshot can't write one, they don't keep the text)
+	bool writeSnapshot(const juce::File& snapshotFile, const juce::File& sourceFile);
+	//memory-maps the snapshot and rebuilds the nodes straight from it, nothing is parsed
+	//with a stream (holding sourceFile's text) the tree is attached to it like a built tree: it keeps the text, its strings
+	//are slices of it and it has source ranges, so it can follow the stream and splice. without one the tree is detached
+	//and read-only, strings are copied into its arena and splicing writes the whole formatted text
+	//nullptr if the snapshot is missing, damaged or out of date with sourceFile (or the stream's text)
+	static std::unique_ptr<Tree> loadSnapshot(const juce::File& snapshotFile, const juce::File& sourceFile, Stream* stream = nullptr);
+	//loads the snapshot if it's up to date, otherwise builds the tree from the stream (which should be sourceFile's) and rewrites the snapshot
+	//the tree is attached to the stream either way
+	static std::unique_ptr<Tree> loadSnapshotOrBuild(Stream* stream, const juce::File& sourceFile, const juce::File& snapshotFile, juce::ThreadPool* threadPool = nullptr);
+
+	//==============================================================================
+	//following stream edits:
+	//the tree patches itself after every Stream::setData()/setString()/setInt(), only the smallest entity around the edit
+	//is read again (or its parents, if the new text doesn't fit it, e.g. a property typed into an object)
+	//replaced nodes stay in the Arena until the whole tree has to be rebuilt, e.g. after an edit outside the base scope
+	//while the text isn't valid json the tree keeps its last valid state and isUpToDate() is false
+	//the stream has to outlive the tree, or stopFollowingStream() has to be called before it's deleted
+
+	void startFollowingStream();
+	void stopFollowingStream();
+	bool isUpToDate() const { return m_isUpToDate; }
+
+	//self-check: builds a fresh tree from the tree's source text and compares every entity with it (types, keys, values,
+	//extras, scope formats, summary flags, source ranges and that string values are slices of the source text)
+	//a lazy tree's stubs only have to match the fresh scope's source range and format, the summaries above them can miss flags
+	//a tree edited with setStringValue()/addProperty() doesn't match its source text. it's a full parse, for debugging
+	bool matchesFreshTree();
+	//the same with a fresh tree of sourceText, for a tree that doesn't keep its text (e.g. loaded from a snapshot, then the
+	//values are compared but not the source ranges)
+	bool matchesFreshTree(const juce::String& sourceText);
+
+	//==============================================================================
+	//lazy loading:
+	//a lazy tree only reads the base scope's children, the objects and arrays among them are stubs that only know their
+	//source range, extras and scope format. a stub's children are read (nested scopes as stubs again) by load()
+	//every loaded scope keeps its nodes in its own Arena, so with a memory budget the least recently used scopes are
+	//turned back into stubs when the loaded nodes need more than the budget, and their nodes are deleted
+	//don't keep pointers into a loaded scope across load() calls if there's a budget. scopes with edits aren't unloaded
+	//walk() treats stubs as empty scopes. formatting, hashes, diffs, snapshots, string property searches and
+	//following the stream need every node, they call loadAll() first
+
+	//memoryBudget is in bytes of loaded nodes, 0 for no limit. the stream is only read while creating the tree
+	static std::unique_ptr<Tree> createLazy(Stream* stream, size_t memoryBudget = 0);
+
+	static bool isStub(const Entity& entity) { return (entity.flags & stubFlag) != 0; }
+	//reads a stub's children, a loaded scope is only marked as used. @return the scope
+	Entity& load(Entity& scope);
+	//loads every stub, the memory budget doesn't apply anymore
+	void loadAll();
+	//turns the loaded scope back into a stub, its loaded children are unloaded too
+	//@return false if it can't be unloaded (the base scope, scopes with edits, or the tree isn't lazy (anymore))
+	bool unload(Entity& scope);
+	bool isLazy() const { return m_isLazy; }
+	size_t getLoadedBytes() const { return m_loadedBytes; }
 
 	//==============================================================================
 	//reading tree structure:
 
 	Entity& getBase() { return *m_base; }
+	//for allocating nodes that are added to this tree
+	Arena& getArena() { return m_arena; }
+
+	//copies the text into the tree's Arena, for adding strings to the tree
+	JsonString* createString(const juce::String& text);
+	//parses the json number text, e.g. "-12.50"
+	JsonNumber* createNumber(const juce::String& text);
+
+	//invalidKeyID if no property in the tree has the key (in a lazy tree, no property that has been loaded)
+	KeyID getKeyId(const juce::String& key) const { return m_keys.find(key); }
+	KeyID getKeyId(const Key& key) const { return m_keys.find(key); }
+	const juce::String& getKey(KeyID keyId) const { return m_keys.getKey(keyId); }
+	KeyID internKey(const juce::String& key) { return m_keys.intern(key); }
+	const KeyPool& getKeyPool() const { return m_keys; }
+
+	//objects with at least this many properties get a hash index on their first lookup
+	static constexpr size_t propertyIndexThreshold = 16;
+	//near-constant time for wide objects, properties keep their order
+	Property* getProperty(Object& object, KeyID keyId);
+	Property* getProperty(Object& object, const juce::String& key);
+
+	//for looking keys up in every record of an array whose objects have the same keys in the same order (API responses,
+	//history exports). it learns each key's property index from the records it has searched, a lookup only checks the
+	//property at the predicted index and falls back to a search (which updates the prediction) if it's another key
+	//	static constexpr json::Key playedAtKey("ts");
+	//	Tree::RecordShape shape(tree);
+	//	for (auto item : items.elements)
+	//		if (auto playedAt = shape.getProperty(item->toObject(), playedAtKey))
+	//a lazy tree only interns the keys of loaded scopes, so use Keys there (they're resolved after the record is loaded),
+	//not KeyIDs fetched before the records are loaded
+	class RecordShape
+	{
+	public:
+		RecordShape(Tree& tree) : m_tree(tree) {}
+
+		Property* getProperty(Object& record, KeyID keyId)
+		{
+			if (keyId < m_predictedIndices.size())
+			{
+				auto index = m_predictedIndices[keyId];
+				if (index < record.properties.size() && record.properties[index]->keyId == keyId)
+					return record.properties[index];
+			}
+			return findProperty(record, keyId);
+		}
+		Property* getProperty(Object& record, const Key& key)
+		{
+			if (isStub(record))
+				m_tree.load(record);
+			return getProperty(record, m_tree.getKeyId(key));
+		}
+
+		//lookups that weren't at the predicted index
+		size_t getNumMisses() const { return m_numMisses; }
 
-	vArray<Tree::Property*> findStringProperties(const juce::String& key, const juce::String& value);
-	void findStringProperties(const juce::String& key, const juce::String& value, 
-														  Entity& currentEntity, vArray<Tree::Property*>& output);
+	private:
+		Property* findProperty(Object& record, KeyID keyId);
+
+		Tree& m_tree;
+		//by KeyID, noPrediction for keys that haven't been found yet
+		std::vector<juce::uint32> m_predictedIndices;
+		static constexpr juce::uint32 noPrediction = 0xffffffff;
+		size_t m_numMisses = 0;
+	};
+
+	//uses the string property index if it has been built, otherwise searches the whole tree (on the pool, if there's one)
+	//results are in document order
+	vArray<Tree::Property*> findStringProperties(const juce::String& key, const juce::String& value, juce::ThreadPool* threadPool = nullptr);
+	void findStringProperties(KeyID keyId, const juce::String& value, Entity& currentEntity, vArray<Tree::Property*>& output);
+
+	//opt-in index of every property with a string value by (key, value), for calling findStringProperties() in a loop
+	//built in one pass, results are in document order (properties added later are at the end)
+	void buildStringPropertyIndex();
+	void clearStringPropertyIndex() { m_stringPropertyIndex.reset(); }
+	bool hasStringPropertyIndex() const { return m_stringPropertyIndex != nullptr; }
+
+	//==============================================================================
+	//walking:
+	//visitors are template parameters, so the compiler can inline them (no std::function call per entity)
+	//a property is visited before its value, scopes before their children in document order
+
+	enum class WalkResult : uint8_t
+	{
+		Continue,     //visits the entity's children
+		SkipChildren, //prunes the entity's subtree
+		Stop          //ends the walk
+	};
+
+	//preVisitor(Entity&) is called before the entity's children, postVisitor(Entity&) after them (also for pruned entities)
+	//both return a WalkResult, SkipChildren from postVisitor is the same as Continue
+	//@return false if the walk was stopped
+	template<class PreVisitor, class PostVisitor>
+	static bool walk(Entity& entity, PreVisitor&& preVisitor, PostVisitor&& postVisitor)
+	{
+		auto result = preVisitor(entity);
+		if (result == WalkResult::Stop)
+			return false;
+
+		if (result == WalkResult::Continue)
+		{
+			if (entity.type == Type::Object)
+			{
+				for (auto p : entity.toObject().properties)
+				{
+					if (!walk(*p, preVisitor, postVisitor))
+						return false;
+				}
+			}
+			else if (entity.type == Type::Array)
+			{
+				for (auto e : entity.toArray().elements)
+				{
+					if (!walk(*e, preVisitor, postVisitor))
+						return false;
+				}
+			}
+			else if (entity.type == Type::Property)
+			{
+				if (!walk(*entity.toProperty().value, preVisitor, postVisitor))
+					return false;
+			}
+		}
+		return postVisitor(entity) != WalkResult::Stop;
+	}
+	//pre-order only
+	template<class Visitor>
+	static bool walk(Entity& entity, Visitor&& visitor)
+	{
+		return walk(entity, visitor, [](Entity&) { return WalkResult::Continue; });
+	}
+
+	//number of jobs walkParallel() splits scope's children into, e.g. for one output per job
+	static int getNumWalkJobs(const Entity& scope, const juce::ThreadPool& threadPool)
+	{
+		if (scope.type == Type::Property)
+			return getNumWalkJobs(*scope.toProperty().value, threadPool);
+		if (!isScopeType(scope.type))
+			return 1;
+		auto numChildren = scope.type == Type::Object ? scope.toObject().properties.size() : scope.toArray().elements.size();
+		return (int)juce::jlimit((size_t)1, (size_t)juce::jmax(1, threadPool.getNumThreads()) * 4, numChildren);
+	}
+
+	//like walk(), for independent subtrees: the scope is visited on the calling thread, then contiguous runs of its
+	//children's subtrees are walked on the pool. visitor(Entity&, int jobIndex) is called concurrently by different jobs,
+	//job i walks the run right after job i - 1's (the scope is visited as job 0), so outputs kept per job and joined by
+	//job index are in document order. Stop ends the walk on every thread (the other jobs stop at their next entity),
+	//so a search for the first match in document order should continue and take the lowest job's match
+	template<class Visitor>
+	static bool walkParallel(Entity& scope, juce::ThreadPool& threadPool, Visitor&& visitor)
+	{
+		auto result = visitor(scope, 0);
+		if (result != WalkResult::Continue)
+			return result != WalkResult::Stop;
+		if (scope.type == Type::Property)
+			return walkParallel(*scope.toProperty().value, threadPool, visitor);
+		if (!isScopeType(scope.type))
+			return true;
+
+		bool isObject = scope.type == Type::Object;
+		auto numChildren = isObject ? scope.toObject().properties.size() : scope.toArray().elements.size();
+		auto numJobs = getNumWalkJobs(scope, threadPool);
+		std::atomic<bool> isStopped{ false };
+		runParallel(threadPool, numJobs, [&](int jobIndex)
+		{
+			auto jobVisitor = [&](Entity& entity)
+			{
+				if (isStopped.load(std::memory_order_relaxed))
+					return WalkResult::Stop;
+				auto childResult = visitor(entity, jobIndex);
+				if (childResult == WalkResult::Stop)
+					isStopped = true;
+				return childResult;
+			};
+
+			auto endChild = numChildren * (size_t)(jobIndex + 1) / (size_t)numJobs;
+			for (auto c = numChildren * (size_t)jobIndex / (size_t)numJobs; c < endChild; c++)
+			{
+				Entity* child = isObject ? (Entity*)scope.toObject().properties[c] : scope.toArray().elements[c];
+				if (!walk(*child, jobVisitor))
+					return;
+			}
+		});
+		return !isStopped;
+	}
+
+	//==============================================================================
+	//editing tree structure (keeps the summary flags and the string property index up to date):
+
+	//property's value has to be a string
+	void setStringValue(Property& property, const juce::String& newValue);
+	//value has to be allocated from getArena(), the properties in its subtree have to use keys from internKey()
+	Property* addProperty(Object& object, const juce::String& key, Entity* value);
 
 private:
 	//==============================================================================
@@ -625,26 +1226,62 @@ private:
 	}
 
 	//==============================================================================
-	void createFormat(const Entity* currentEntity, juce::String& output, int currentIndent, bool indentBeforeEntity = false);
-	void createExtras(const std::vector<Extra*>& extras, juce::String& output, int indentCount);
-	void createObject(const Object& currentObject, juce::String& output, int currentIndent, ScopeFormat scopeFormat);
-	void createArray(const Array& currentArray, juce::String& output, int currentIndent, ScopeFormat scopeFormat);
+	static void diff(Tree& oldTree, Tree& newTree, Entity& oldEntity, Entity& newEntity, const juce::String& path, vArray<Difference>& output);
+
+	//sets modifiedFlag on the entity (if it's a value) and containsModifiedFlag on it and its parents
+	static void setModified(Entity& entity, bool isValueChanged);
+	//ruleState is the FormatRules match state at entity's path, m_activeFormatRules has to be set
+	void getSourceEdits(const Entity& entity, const FormatRuleState& ruleState, vArray<SourceEdit>& output);
+	//edit that adds the properties without a source range to the end of the object
+	SourceEdit getAddedPropertiesEdit(const Object& object, const Property* lastSourceProperty, const FormatRuleState& ruleState);
+	//number of tabs the line containing the source text offset starts with
+	int getSourceIndent(juce::uint32 sourceOffset) const;
+	void setSourceRange(Entity& entity, const char* sourceStart) const;
+	//sets m_activeFormatRules and m_formatRuleKeyIds
+	void prepareFormatRules();
+	//formats the base scope like createFormat(), its children are formatted into a buffer per job and then joined
+	//@return false if the document isn't worth splitting, nothing has been written in that case
+	bool writeTextParallel(juce::OutputStream& output, juce::ThreadPool& threadPool);
+
+	void jsonTextEdited(Stream& stream, size_t startByte, size_t oldEndByte, size_t newEndByte) override;
+	//deepest entity whose source range contains [startByte, endByte)
+	static Entity* findSourceEntity(Entity& entity, size_t startByte, size_t endByte);
+	//reads oldEntity's new text [startByte, endByte), nullptr if it isn't a single value (or property, for properties)
+	Entity* retokenize(const Entity& oldEntity, const juce::String& newText, size_t startByte, size_t endByte);
+	void replaceEntity(Entity& oldEntity, Entity& newEntity);
+	//summary flags of the scope from its children, for when a child was replaced
+	static void updateSummaryFlags(Entity& scope);
+	struct TextMove;
+	//moves the source ranges and slices of every entity (except skipEntity's subtree) to the new text
+	static void moveToNewText(Entity& entity, const Entity& skipEntity, const TextMove& move);
+	//nodes are read again from the whole stream text
+	void rebuild();
+
+	//==============================================================================
+	//strings, numbers, bools and null
+	static void writeValue(const Entity& value, juce::OutputStream& output);
+	//ruleState is the FormatRules match state at currentEntity's path
+	void createFormat(const Entity* currentEntity, juce::OutputStream& output, int currentIndent, const FormatRuleState& ruleState, bool indentBeforeEntity = false);
+	void createExtras(const Extras& extras, juce::OutputStream& output, int indentCount);
+	void createObject(const Object& currentObject, juce::OutputStream& output, int currentIndent, ScopeFormat scopeFormat, const FormatRuleState& ruleState);
+	void createArray(const Array& currentArray, juce::OutputStream& output, int currentIndent, ScopeFormat scopeFormat, const FormatRuleState& ruleState);
 
 	bool containsComments(const Entity* entity);
-	bool containsComments(const std::vector<Extra*>& extras);
+	bool containsComments(const Extras& extras);
 
 	//ignores the extas above objectEntity
-	bool containsExtras(const Object* objectEntity);
+	bool containsExtras(const Object* objectEntity) { return (objectEntity->flags & containsExtrasFlag) != 0; }
 	//ignores the extas above arrayEntity
-	bool containsExtras(const Array* arrayEntity);
-	bool containsExtras(const Entity* entity);
+	bool containsExtras(const Array* arrayEntity) { return (arrayEntity->flags & containsExtrasFlag) != 0; }
+	bool containsExtras(const Entity* entity) { return entity->extras.size() > 0 || (entity->flags & containsExtrasFlag) != 0; }
 
 	bool containsNestedScopes(const Object& checkScope);
 	bool containsNestedScopes(const Array& checkScope);
-	bool checkIfAnyPropertyMeetsCondition(Object& checkObject, std::function<bool(Property*)> condition);
-	bool containsNestedObjects(const Array& checkScope);
+	bool containsNestedObjects(const Array& checkScope) { return (checkScope.flags & containsNestedObjectsFlag) != 0; }
 
-	juce::String getIndentString(int indentCount);
+	static void writeIndent(juce::OutputStream& output, int indentCount);
+	static void writeString(juce::OutputStream& output, const juce::String& text);
+	static void writeLineFeed(juce::OutputStream& output) { output.write(lineFeed, sizeof(lineFeed) - 1); }
 
 	//==============================================================================
 	//for custom formatting
@@ -655,10 +1292,70 @@ private:
 private:
 	//==============================================================================
 
+	Arena m_arena;
+	KeyPool m_keys;
 	Entity* m_base = nullptr;
 	Stream* m_stream;
-
-	const char* lineFeed = "\r\n";
+	//JsonStrings are slices of this text, the reference keeps it alive if the stream changes or is deleted
+	juce::String m_sourceText;
+	//size of the text the tree was built from, for preallocating formatted text
+	size_t m_sourceBytes = 0;
+	//for getClosedScopeFormat(), only valid while initializing
+	const char* m_newLineScanPosition = nullptr;
+	const char* m_lastNewLine = nullptr;
+
+	//trees that built chunks of this tree in parallel, they own the chunks' nodes and keys
+	std::vector<std::unique_ptr<Tree>> m_chunkTrees;
+	//only set in chunk trees
+	std::unique_ptr<Stream> m_chunkStream;
+	//properties made by a chunk tree, their KeyIDs are changed to this tree's KeyIDs after the chunk is built
+	std::vector<Property*> m_chunkProperties;
+	bool m_isChunk = false;
+	const FormatRules* m_formatRules = nullptr;
+	//only valid while formatting
+	const FormatRules* m_activeFormatRules = nullptr;
+	//FormatRules key id of each KeyID, only valid while formatting
+	std::vector<int> m_formatRuleKeyIds;
+
+	//indexed by KeyID, then by string value
+	typedef std::vector<std::unordered_map<juce::String, vArray<Property*>>> StringPropertyIndex;
+	std::unique_ptr<StringPropertyIndex> m_stringPropertyIndex;
+	void addToStringPropertyIndex(Entity& currentEntity);
+	void removeFromStringPropertyIndex(Entity& currentEntity);
+
+	bool m_isFollowingStream = false;
+	bool m_isUpToDate = true;
+	//the tree holds the stream's edited text, not the text it was built from (no snapshots)
+	bool m_hasFollowedEdits = false;
+
+	//nodes read by initializeJson() go here, it's a loaded scope's arena while a lazy tree's stub is loaded
+	Arena* m_buildArena = &m_arena;
+	struct LoadedScope
+	{
+		std::unique_ptr<Arena> arena;
+		//the scope's entry in m_leastRecentlyUsed
+		std::list<const Entity*>::iterator lruPosition;
+		//arena bytes after loading, what's counted for the memory budget
+		size_t numBytes = 0;
+		//loaded scope whose arena holds this scope's node, nullptr for the base
+		const Entity* parentScope = nullptr;
+		//loaded scopes whose parentScope is this one, they're unloaded with it
+		std::vector<const Entity*> childScopes;
+	};
+	std::unordered_map<const Entity*, LoadedScope> m_loadedScopes;
+	//loaded scopes from the least to the most recently loaded or used
+	std::list<const Entity*> m_leastRecentlyUsed;
+	//own stream over m_sourceText for loading stubs, the tree's stream may have changed since
+	std::unique_ptr<Stream> m_lazyStream;
+	size_t m_loadedBytes = 0;
+	size_t m_memoryBudget = 0;
+	bool m_isLazy = false;
+	//createLazy() reads the base scope's children right away, only the scopes below it are stubs
+	bool m_isReadingLazyBase = false;
+	//unloads the least recently used scopes until the budget is met, usedScope and its parents are kept
+	void applyMemoryBudget(const Entity& usedScope);
+
+	static constexpr char lineFeed[] = "\r\n";
 
 	//==============================================================================
 };
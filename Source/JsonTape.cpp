@@ -0,0 +1,348 @@
+#include "JsonTape.h"
+
+namespace json
+{
+Tape::Tape(Stream* stream) : m_stream(stream)
+{
+    if (m_stream == nullptr || m_stream->getStart().isNotValid())
+        return;
+
+    m_words.reserve(m_stream->getEntireJsonText().length() / 8);
+    m_stream->goToJsonStart();
+    if (!parseValue())
+    {
+        //truncated or invalid text, isValid() is false
+        m_words.clear();
+        m_strings.clear();
+    }
+    m_stream = nullptr; //only used while parsing
+}
+
+bool Tape::parseValue()
+{
+    switch (getTypeFromChar(m_stream->getCurrentChar()))
+    {
+        case Type::Object:
+        case Type::Array:
+        {
+            bool isObject = m_stream->isAtChar('{');
+            char closeChar = isObject ? '}' : ']';
+            auto openIndex = (juce::uint32)m_words.size();
+            addWord(m_stream->getCurrentChar());
+
+            m_stream->readNextPosition(); //after '{' or '['
+            m_stream->skipCommentsAndWhitespaces();
+
+            juce::uint64 count = 0;
+            while (!m_stream->isAtChar(closeChar))
+            {
+                if (isObject)
+                {
+                    if (!m_stream->isAtChar('\"') || !parseString()) //key
+                        return false;
+                    m_stream->skipCommentsAndWhitespaces();
+                    if (!m_stream->isAtChar(':'))
+                        return false;
+                    m_stream->readNextPosition();
+                    m_stream->skipCommentsAndWhitespaces();
+                }
+                if (!parseValue())
+                    return false;
+                count++;
+
+                //values are separated by commas, anything else has to be the close char
+                m_stream->skipCommentsAndWhitespaces();
+                if (m_stream->isAtChar(','))
+                {
+                    m_stream->readNextPosition();
+                    m_stream->skipCommentsAndWhitespaces();
+                }
+                else if (!m_stream->isAtChar(closeChar))
+                    return false;
+            }
+            m_stream->readNextPosition(); //after '}' or ']'
+
+            addWord(closeChar, openIndex);
+            //count is saturated at 24 bits, getSize() counts the elements when it's hit
+            m_words[openIndex] |= (juce::jmin(count, (juce::uint64)0xffffff) << 32) | (juce::uint64)m_words.size();
+            return true;
+        }
+        case Type::String: return parseString();
+        case Type::Number: return parseNumber();
+        case Type::Bool:
+        case Type::Null:
+        {
+            //getTypeFromChar() only looks at the first char
+            auto reader = m_stream->getReader().getAddress();
+            for (auto literal : { "true", "false", "null" })
+            {
+                auto numBytes = (int)strlen(literal);
+                if (strncmp(reader, literal, (size_t)numBytes) == 0)
+                {
+                    addWord(*literal);
+                    m_stream->readNextPosition(numBytes);
+                    return true;
+                }
+            }
+            return false;
+        }
+        default: return false; //unexpected char (or the end of the text)
+    }
+}
+
+bool Tape::parseString()
+{
+    jassert(m_stream->isAtChar('\"'));
+
+    //copies the raw bytes, escape sequences are kept as they are (same as Stream::getString())
+    auto stringStart = m_stream->getReader().getAddress() + 1;
+    m_stream->skipString(false);
+    if (!m_stream->isAtChar('\"')) //no end quote
+        return false;
+    auto length = (juce::uint32)(m_stream->getReader().getAddress() - stringStart);
+    m_stream->readNextPosition(); //after end quote
+
+    addWord('\"', m_strings.size());
+    auto lengthBytes = (const char*)&length;
+    m_strings.insert(m_strings.end(), lengthBytes, lengthBytes + sizeof(length));
+    m_strings.insert(m_strings.end(), stringStart, stringStart + length);
+    m_strings.push_back(0);
+    return true;
+}
+
+bool Tape::parseNumber()
+{
+    auto numberStart = m_stream->getReader().getAddress();
+    m_stream->skipNumber(true);
+    auto numberEnd = m_stream->getReader().getAddress();
+
+    bool isNegative = *numberStart == '-';
+    auto digitsStart = isNegative ? numberStart + 1 : numberStart;
+    if (digitsStart == numberEnd || *digitsStart < '0' || *digitsStart > '9')
+        return false;
+
+    //up to 18 digits always fit in an int64, longer integers are read as doubles
+    juce::int64 intValue = 0;
+    auto reader = digitsStart;
+    while (reader != numberEnd && *reader >= '0' && *reader <= '9' && reader - digitsStart < 18)
+    {
+        intValue = intValue * 10 + (*reader - '0');
+        reader++;
+    }
+
+    juce::uint64 valueWord;
+    if (reader == numberEnd) //integer
+    {
+        addWord('l');
+        intValue = isNegative ? -intValue : intValue;
+        memcpy(&valueWord, &intValue, sizeof(valueWord));
+    }
+    else
+    {
+        addWord('d');
+        juce::CharPointer_UTF8 numberReader(numberStart);
+        double doubleValue = juce::CharacterFunctions::readDoubleValue(numberReader);
+        memcpy(&valueWord, &doubleValue, sizeof(valueWord));
+    }
+    m_words.push_back(valueWord);
+    return true;
+}
+
+juce::uint32 Tape::getNextIndex(juce::uint32 index) const
+{
+    switch (getTag(index))
+    {
+        case '{':
+        case '[': return (juce::uint32)(getPayload(index) & 0xffffffff);
+        case 'l':
+        case 'd': return index + 2;
+        default: return index + 1;
+    }
+}
+
+const char* Tape::getStringData(juce::uint32 index, juce::uint32& length) const
+{
+    jassert(getTag(index) == '\"');
+    auto data = m_strings.data() + getPayload(index);
+    memcpy(&length, data, sizeof(length));
+    return data + sizeof(length);
+}
+
+bool Tape::isStringEqual(juce::uint32 index, const juce::String& compare) const
+{
+    juce::uint32 length;
+    auto data = getStringData(index, length);
+    return compare.getNumBytesAsUTF8() == length && memcmp(data, compare.toRawUTF8(), length) == 0;
+}
+
+//==============================================================================
+
+void Tape::Iterator::operator++()
+{
+    if (isObject)
+        index++; //skip key
+    index = tape->getNextIndex(index);
+}
+
+Tape::Value Tape::Iterator::operator*() const
+{
+    if (isObject)
+        return Value(tape, index + 1, index);
+    return Value(tape, index);
+}
+
+Type Tape::Value::getType() const
+{
+    if (!isValid())
+        return Type::None;
+
+    switch (m_tape->getTag(m_index))
+    {
+        case '{': return Type::Object;
+        case '[': return Type::Array;
+        case '\"': return Type::String;
+        case 'l':
+        case 'd': return Type::Number;
+        case 't':
+        case 'f': return Type::Bool;
+        case 'n': return Type::Null;
+        default: jassertfalse; return Type::None;
+    }
+}
+
+Tape::Value Tape::Value::getProperty(const juce::String& propertyKey) const
+{
+    if (!isType(Type::Object))
+        return Value();
+
+    auto endIndex = m_tape->getNextIndex(m_index) - 1; //at '}'
+    auto index = m_index + 1;
+    while (index < endIndex)
+    {
+        if (m_tape->isStringEqual(index, propertyKey))
+            return Value(m_tape, index + 1, index);
+        index = m_tape->getNextIndex(index + 1);
+    }
+    return Value();
+}
+
+juce::StringArray Tape::Value::getPropertyKeys() const
+{
+    juce::StringArray output;
+    for (auto it = begin(); it != end(); ++it)
+        output.add((*it).getKey());
+    return output;
+}
+
+juce::String Tape::Value::getKey() const
+{
+    if (!isValid() || m_keyIndex == noKey)
+        return juce::String();
+
+    juce::uint32 length;
+    auto data = m_tape->getStringData(m_keyIndex, length);
+    return juce::String::fromUTF8(data, (int)length);
+}
+
+Tape::Value Tape::Value::operator[](int index) const
+{
+    if (!isType(Type::Array) || index < 0)
+        return Value();
+
+    int currentIndex = 0;
+    for (auto it = begin(); it != end(); ++it)
+    {
+        if (currentIndex++ == index)
+            return *it;
+    }
+    return Value();
+}
+
+int Tape::Value::getSize() const
+{
+    if (!isValid() || !isScopeType(getType()))
+        return 0;
+
+    auto count = (int)((m_tape->getPayload(m_index) >> 32) & 0xffffff);
+    if (count < 0xffffff)
+        return count;
+
+    count = 0;
+    for (auto it = begin(); it != end(); ++it)
+        count++;
+    return count;
+}
+
+Tape::Iterator Tape::Value::begin() const
+{
+    if (!isValid() || !isScopeType(getType()))
+        return end();
+    return Iterator(m_tape, m_index + 1, isType(Type::Object));
+}
+
+Tape::Iterator Tape::Value::end() const
+{
+    if (!isValid() || !isScopeType(getType()))
+        return Iterator(m_tape, m_index, false);
+    return Iterator(m_tape, m_tape->getNextIndex(m_index) - 1, isType(Type::Object));
+}
+
+juce::String Tape::Value::getString() const
+{
+    jassert(isType(Type::String));
+    if (!isType(Type::String))
+        return juce::String();
+
+    juce::uint32 length;
+    auto data = m_tape->getStringData(m_index, length);
+    return juce::String::fromUTF8(data, (int)length);
+}
+
+juce::int64 Tape::Value::getInt64() const
+{
+    jassert(isType(Type::Number));
+    if (!isType(Type::Number))
+        return 0;
+
+    auto valueWord = m_tape->m_words[m_index + 1];
+    if (m_tape->getTag(m_index) == 'd')
+    {
+        double doubleValue;
+        memcpy(&doubleValue, &valueWord, sizeof(doubleValue));
+        //saturated, casting a double that's out of range (or nan) is undefined
+        if (!(doubleValue > (double)std::numeric_limits<juce::int64>::lowest()))
+            return std::numeric_limits<juce::int64>::lowest();
+        if (!(doubleValue < (double)std::numeric_limits<juce::int64>::max()))
+            return std::numeric_limits<juce::int64>::max();
+        return (juce::int64)doubleValue;
+    }
+    juce::int64 intValue;
+    memcpy(&intValue, &valueWord, sizeof(intValue));
+    return intValue;
+}
+
+double Tape::Value::getDouble() const
+{
+    jassert(isType(Type::Number));
+    if (!isType(Type::Number))
+        return 0.0;
+
+    auto valueWord = m_tape->m_words[m_index + 1];
+    if (m_tape->getTag(m_index) == 'l')
+    {
+        juce::int64 intValue;
+        memcpy(&intValue, &valueWord, sizeof(intValue));
+        return (double)intValue;
+    }
+    double doubleValue;
+    memcpy(&doubleValue, &valueWord, sizeof(doubleValue));
+    return doubleValue;
+}
+
+bool Tape::Value::getBool() const
+{
+    jassert(isType(Type::Bool));
+    return isValid() && m_tape->getTag(m_index) == 't';
+}
+
+} //namespace json
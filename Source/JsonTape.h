@@ -0,0 +1,130 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "JsonStream.h"
+
+namespace json
+{
+
+//read-only alternative to Tree, the whole document is a flat array of 64-bit words
+//
+//each word is a type tag (top 8 bits) and a payload (low 56 bits):
+//  '{' '[' payload: element count (bits 32-55), index after the matching close word (bits 0-31)
+//  '}' ']' payload: index of the matching open word
+//  '"'     payload: offset of the string in the string buffer (keys are strings before their value)
+//  'l' 'd' payload unused, the next word is the int64/double
+//  't' 'f' 'n'
+//
+//comments and formatting are not kept, use Tree for editing/formatting
+class Tape
+{
+public:
+	//==============================================================================
+	Tape(Stream* stream);
+
+	class Value;
+
+	struct Iterator
+	{
+		Iterator(const Tape* tape, juce::uint32 index, bool isObject) : tape(tape), index(index), isObject(isObject) {}
+
+		bool operator!=(const Iterator& compare) const { return index != compare.index; }
+		void operator++();
+		Value operator*() const;
+
+		const Tape* tape;
+		juce::uint32 index;
+		bool isObject;
+	};
+
+	class Value
+	{
+	public:
+		Value() {}
+		Value(const Tape* tape, juce::uint32 index, juce::uint32 keyIndex = noKey) : m_tape(tape), m_index(index), m_keyIndex(keyIndex) {}
+
+		Type getType() const;
+		bool isType(Type compareType) const { return getType() == compareType; }
+		bool isValid() const { return m_tape != nullptr; }
+		bool isNull() const { return getType() == Type::Null; }
+		explicit operator bool() const { return isValid(); }
+
+		//==============================================================================
+		//objects:
+
+		Value operator[](const juce::String& propertyKey) const { return getProperty(propertyKey); }
+		Value getProperty(const juce::String& propertyKey) const;
+		juce::StringArray getPropertyKeys() const;
+		//key of the property this value belongs to, empty if it isn't a property's value
+		juce::String getKey() const;
+
+		//==============================================================================
+		//arrays:
+
+		Value operator[](int index) const;
+
+		//==============================================================================
+		//objects and arrays:
+
+		//property count or element count
+		int getSize() const;
+		//iterates the values of an object's properties (use getKey()) or an array's elements
+		Iterator begin() const;
+		Iterator end() const;
+
+		//==============================================================================
+		//values:
+
+		juce::String getString() const;
+		//numbers out of range are saturated
+		juce::int64 getInt64() const;
+		int getIntValue() const { return (int)juce::jlimit((juce::int64)std::numeric_limits<int>::lowest(), (juce::int64)std::numeric_limits<int>::max(), getInt64()); }
+		double getDouble() const;
+		float getFloatValue() const { return (float)getDouble(); }
+		bool getBool() const;
+
+	private:
+		static constexpr juce::uint32 noKey = 0xffffffff;
+
+		const Tape* m_tape = nullptr;
+		juce::uint32 m_index = 0;
+		juce::uint32 m_keyIndex = noKey;
+	};
+
+	//==============================================================================
+	//false if the stream's text is empty, truncated or not valid json
+	bool isValid() const { return m_words.size() > 0; }
+	Value getBase() const { return isValid() ? Value(this, 0) : Value(); }
+
+	size_t getNumWords() const { return m_words.size(); }
+	size_t getMemoryUsage() const { return m_words.size() * sizeof(juce::uint64) + m_strings.size(); }
+
+private:
+	//==============================================================================
+	//@return false if the text isn't valid json there
+	bool parseValue();
+	bool parseString();
+	bool parseNumber();
+	void addWord(char tag, juce::uint64 payload = 0) { m_words.push_back(((juce::uint64)(juce::uint8)tag << 56) | (payload & payloadMask)); }
+
+	char getTag(juce::uint32 index) const { return (char)(m_words[index] >> 56); }
+	juce::uint64 getPayload(juce::uint32 index) const { return m_words[index] & payloadMask; }
+	//index of the word after the value starting at index
+	juce::uint32 getNextIndex(juce::uint32 index) const;
+
+	const char* getStringData(juce::uint32 index, juce::uint32& length) const;
+	bool isStringEqual(juce::uint32 index, const juce::String& compare) const;
+
+	//==============================================================================
+	static constexpr juce::uint64 payloadMask = 0x00ffffffffffffff;
+
+	Stream* m_stream;
+	std::vector<juce::uint64> m_words;
+	//each string is its byte length (uint32), its bytes, then a null terminator
+	std::vector<char> m_strings;
+
+	//==============================================================================
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Tape)
+};
+
+} //namespace json
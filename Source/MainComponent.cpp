@@ -12,7 +12,10 @@ MainComponent::MainComponent()
     addAndMakeVisible(showRecentAlbumsButton);
     showRecentAlbumsButton.onClick = [=]
     {
-        playedTracks.add(readTracks(juce::SystemClipboard::getTextFromClipboard()));
+        auto newTracks = readTracks(juce::SystemClipboard::getTextFromClipboard());
+        playedTracks.add(newTracks);
+        if (playedTracks.isEmpty())
+            return;
 
         //get next before time
         {
@@ -20,7 +23,7 @@ MainComponent::MainComponent()
             //2025-05-22T18:31:32.751Z
             //012345678901234567890123
             //0         10        20  
-            jString& timePlayedString = playedTracks.getLast()->timePlayed;
+            jString& timePlayedString = playedTracks.getLast().timePlayed;
             tm lastTrackPlayTime = { 0 };
             lastTrackPlayTime.tm_year = timePlayedString.substring(0, 4).getIntValue() - 1900;
             lastTrackPlayTime.tm_mon = timePlayedString.substring(5, 7).getIntValue() - 1;
@@ -41,11 +44,11 @@ MainComponent::MainComponent()
         Track* previousTrack = nullptr;
         for (size_t i = 0; i < playedTracks.size(); i++)
         {
-            if ( previousTrack != nullptr && playedTracks[i]->isSameAlbum(previousTrack) && (playedAlbums.size() == 0 || !playedAlbums.getLast()->isSameAlbum(playedTracks[i])) )
+            if ( previousTrack != nullptr && playedTracks[i].isSameAlbum(previousTrack) && (playedAlbums.size() == 0 || !playedAlbums.getLast()->isSameAlbum(&playedTracks[i])) )
             {
-                playedAlbums.add(playedTracks[i]);
+                playedAlbums.add(&playedTracks[i]);
             }
-            previousTrack = playedTracks[i];
+            previousTrack = &playedTracks[i];
         }
 
         jString resultsString = "";
@@ -62,7 +65,7 @@ MainComponent::MainComponent()
         jString resultsString = "";
         for (auto& i : readTracks(juce::SystemClipboard::getTextFromClipboard()))
         {
-            resultsString += i->artistName + " - " + i->albumName + " - " + i->timePlayed + "\n";
+            resultsString += i.artistName + " - " + i.albumName + " - " + i.timePlayed + "\n";
         }
         resultsView.setText(resultsString);
     };
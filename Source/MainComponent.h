@@ -4,6 +4,7 @@
 #include <chrono>
 #include "Globals.h"
 #include "JsonStream.h"
+#include "JsonBinding.h"
 
 
 //==============================================================================
@@ -89,26 +90,30 @@ public:
         jString timePlayed;
     };
 
-    vArray<Track*> readTracks(const jString& jsonString)
+    static constexpr auto trackBinding = json::makeBinding<Track>(json::bind("track/artists/[0]/name", &Track::artistName),
+                                                                  json::bind("track/album/name", &Track::albumName),
+                                                                  json::bind("track/name", &Track::songName),
+                                                                  json::bind("played_at", &Track::timePlayed));
+
+    vArray<Track> readTracks(const jString& jsonString)
     {
-        vArray<Track*> output;
+        vArray<Track> output;
 
-        json::Stream stream(juce::SystemClipboard::getTextFromClipboard());
+        json::Stream stream(jsonString);
         if (stream.getStart().isNotValid())
             return output;
 
+        static constexpr json::Key itemsKey("items");
+        auto items = stream[itemsKey];
+        if (!items.isType(json::Type::Array))
+            return output;
 
-        for (auto& item : stream["items"].getArray())
-        {
-            output.add(new Track(item["track"]["artists"].getArray()[0]["name"].getString(),
-                                       item["track"]["album"]["name"].getString(),
-                                       item["track"]["name"].getString(),
-                                       item["played_at"].getString()));
-        }
+        stream.goToPosition(items);
+        trackBinding.decodeArray(stream, output);
         return output;
     }
 
-    vArray<Track*> playedTracks;
+    vArray<Track> playedTracks;
 
     //==============================================================================
     void paint (juce::Graphics&) override;